@@ -0,0 +1,334 @@
+/**
+ * @brief Child Process Manager benchmarks
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ *
+ * Usage: childprocess-bench [name...]
+ *
+ * Runs the named benchmarks, or all of them if no name is given.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+#include <vector>
+#include <sched.h>
+#include <signal.h>
+#include <sys/resource.h>
+
+#include "childprocess.hpp"
+#include "pipeline.hpp"
+#include "textfilter.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Seconds elapsed since a point in time
+double since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// CPU time (user+system) used by the calling thread so far, in seconds
+double thread_cpu() {
+    rusage ru;
+    getrusage(RUSAGE_THREAD,&ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec)/1e6;
+}
+
+/*
+ * Full path name of the synthetic workload program, which is built
+ * next to this benchmark program.
+ */
+std::string workload() {
+    static const auto path = (std::filesystem::read_symlink("/proc/self/exe").parent_path() / "childprocess-workload").string();
+    return path;
+}
+
+/*
+ * Pipe throughput through the workload program with the I/O threads
+ * running anywhere, on the child's CPU, or in the child's LLC domain.
+ * The child is pinned to the last CPU we may use.
+ */
+void colocate() {
+    const auto mb = 256;
+    const auto chunk = std::string(64*1024,'x');
+
+    cpu_set_t mask;
+    sched_getaffinity(0,sizeof(mask),&mask);
+    auto cpu = CPU_SETSIZE-1;
+    while(cpu>0 && !CPU_ISSET(cpu,&mask)) --cpu;
+
+    const std::pair<const char*,int> modes[] = {
+        { "unpinned", 0 },
+        { "PINCORE",  ChildProcess::PINCORE },
+        { "PINLLC",   ChildProcess::PINLLC }
+    };
+
+    std::cout << "colocate: " << mb << " MB through workload --echo, child on CPU " << cpu << "\n";
+    for(const auto& mode : modes) {
+        auto best = 0.0;
+        for(auto run=0;run<3;++run) {
+            ChildProcess chld(workload(),{ "--echo" },
+                ChildProcess::IN | ChildProcess::OUT | mode.second,
+                [cpu](){
+                    cpu_set_t set;
+                    CPU_ZERO(&set);
+                    CPU_SET(cpu,&set);
+                    sched_setaffinity(0,sizeof(set),&set);
+                }
+            );
+
+            const auto start = Clock::now();
+            auto in = chld.make_stdin([&](std::ostream& os) {
+                for(auto i=0;i<mb*16;++i) os.write(chunk.data(),chunk.size());
+            });
+            auto out = chld.get_stdout([](std::istream& is) {
+                char buf[64*1024];
+                while(is.read(buf,sizeof(buf)) || is.gcount()) {}
+            });
+            in.get();
+            out.get();
+            chld.join();
+
+            best = std::max(best,mb/since(start));
+        }
+        std::cout << "  " << std::setw(10) << std::left << mode.first
+                  << std::fixed << std::setprecision(1) << best << " MB/s\n";
+    }
+}
+
+/*
+ * Commands per second run through Pipeline versus through /bin/sh -c.
+ */
+void shell() {
+    const auto runs = 500;
+    const char* cmdlines[] = {
+        "true",
+        "echo hello | cat >/dev/null",
+        "LC_ALL=C sort </dev/null 2>&1 | uniq -c >/dev/null"
+    };
+
+    std::cout << "shell: commands/s, " << runs << " runs each\n";
+    for(const auto cmdline : cmdlines) {
+        auto start = Clock::now();
+        for(auto i=0;i<runs;++i) {
+            Pipeline(cmdline).join();
+        }
+        const auto direct = runs/since(start);
+
+        start = Clock::now();
+        for(auto i=0;i<runs;++i) {
+            ChildProcess("/bin/sh",{ "-c", cmdline }).join();
+        }
+        const auto sh = runs/since(start);
+
+        std::cout << "  " << std::setw(52) << std::left << cmdline
+                  << std::fixed << std::setprecision(0)
+                  << "Pipeline " << std::setw(8) << direct
+                  << "/bin/sh " << sh << "\n";
+    }
+}
+
+/*
+ * Throughput of reading the workload's output, raw and through TextFilter,
+ * and of TextFilter alone on ASCII, non-ASCII, escape-heavy, and invalid text.
+ */
+void textfilter() {
+    const auto mb = 256;
+
+    std::cout << "textfilter: " << mb << " MB of ASCII from workload --emit\n";
+    for(const auto filter : { false, true }) {
+        auto best = 0.0;
+        for(auto run=0;run<3;++run) {
+            ChildProcess chld(workload(),{ "--emit=" + std::to_string(mb<<20) },ChildProcess::OUT);
+            const auto start = Clock::now();
+            auto bytes = size_t(0);
+            const auto count = [&bytes](std::string_view chunk){ bytes += chunk.size(); };
+            auto out = filter
+                ? chld.read_stdout(TextFilter(count))
+                : chld.read_stdout(count);
+            out.get();
+            chld.join();
+            best = std::max(best,(bytes>>20)/since(start));
+        }
+        std::cout << "  " << std::setw(10) << std::left << (filter ? "filtered" : "raw")
+                  << std::fixed << std::setprecision(1) << best << " MB/s\n";
+    }
+
+    // Content that leaves the ASCII fast path, filtered in memory in 64 KB chunks
+    const std::pair<const char*,std::string> lines[] = {
+        { "ascii",   "2016-10-20 12:00:00 INFO Request handled in 12 ms, status 200, 512 bytes\n" },
+        { "utf8",    "\xd0\x97\xd0\xb0\xd0\xbf\xd1\x80\xd0\xbe\xd1\x81 \xe5\xa4\x84\xe7\x90\x86\xe5\xae\x8c\xe6\x88\x90 \xf0\x9f\x98\x80 caf\xc3\xa9 na\xc3\xafve \xe2\x82\xac 12\n" },
+        { "ansi",    "\x1b[32m2016-10-20\x1b[0m \x1b[1;34mINFO\x1b[0m \x1b]0;title\x07Request \x1b[33m200\x1b[0m\n" },
+        { "invalid", "bad \xff\xfe bytes \xc0\xaf and \xed\xa0\x80 truncated \xe2\x82 end\n" },
+    };
+    std::cout << "  in memory, " << mb << " MB each:\n";
+    for(const auto& line : lines) {
+        std::string data;
+        while(data.size()<size_t(mb)<<20) data += line.second;
+        auto best = 0.0;
+        for(auto run=0;run<3;++run) {
+            auto bytes = size_t(0);
+            TextFilter filter([&bytes](std::string_view chunk){ bytes += chunk.size(); });
+            const auto start = Clock::now();
+            for(size_t pos=0;pos<data.size();pos+=65536) {
+                filter(std::string_view(data).substr(pos,65536));
+            }
+            filter(std::string_view());
+            best = std::max(best,(data.size()>>20)/since(start));
+        }
+        std::cout << "  " << std::setw(10) << std::left << line.first
+                  << std::fixed << std::setprecision(1) << best << " MB/s\n";
+    }
+}
+
+/*
+ * Time spent in ~ChildProcess for children that react differently to
+ * SIGTERM, destroyed one at a time and many at once, with the CPU time
+ * the destroying thread spends waiting (per child). Each behaviour runs
+ * with the default flags and with PGROUP. Children report the PIDs of
+ * their grandchildren on stdout, so those left behind can be counted and
+ * cleaned up either way.
+ */
+void teardown() {
+    struct Behaviour {
+        const char* name;
+        std::vector<std::string> args;
+        int single;                         // Runs destroying one child
+        int bulk;                           // Children destroyed at once
+    };
+    const Behaviour behaviours[] = {
+        { "exit",       { "--sigterm=default" },               50, 32 },
+        { "slow:50",    { "--sigterm=slow:50" },               20, 16 },
+        { "children:4", { "--sigterm=default", "--children=4" }, 20, 16 },
+        { "ignore",     { "--sigterm=ignore" },                3,  3  },
+    };
+    const std::pair<const char*,int> modes[] = {
+        { "default", 0 },
+        { "PGROUP",  ChildProcess::PGROUP },
+    };
+
+    // Start a child and wait until it has set up its signal handling,
+    // collecting the PIDs of its grandchildren
+    const auto start = [](const Behaviour& b,int flags,std::vector<pid_t>& grandchildren){
+        auto args = b.args;
+        args.insert(args.end(),{ "--ready", "--exit-delay=600000" });
+        ChildProcess chld(workload(),args,ChildProcess::OUT | flags);
+        chld.get_stdout([&grandchildren](std::istream& is){
+            for(std::string line;std::getline(is,line) && line!="ready";) {
+                grandchildren.push_back(std::stoi(line));
+            }
+        }).get();
+        return chld;
+    };
+
+    // Count and kill the grandchildren still running, after giving those
+    // killed by the dtor a moment to die (they may then stay zombies if
+    // nobody reaps them)
+    const auto orphans = [](const std::vector<pid_t>& pids){
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        auto ret = 0;
+        for(const auto pid : pids) {
+            std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+            std::string field, state;
+            std::getline(stat,field,')');
+            if (stat >> state && state!="Z") {
+                ++ret;
+                kill(pid,SIGKILL);
+            }
+        }
+        return ret;
+    };
+
+    const auto ms = [](double s){ return s*1000; };
+
+    std::cout << "teardown: ~ChildProcess latency and CPU time of the destroying thread per child (ms)\n"
+              << "  " << std::setw(12) << std::left << "child" << std::setw(9) << "flags" << std::right
+              << std::setw(6) << "runs" << std::setw(9) << "min" << std::setw(9) << "p50"
+              << std::setw(9) << "p90" << std::setw(9) << "max" << std::setw(9) << "cpu"
+              << std::setw(9) << "orphans" << "\n";
+    for(const auto& mode : modes) {
+        for(const auto& b : behaviours) {
+            std::vector<double> lat;
+            std::vector<pid_t> grandchildren;
+            auto cpu = 0.0;
+            for(auto run=0;run<b.single;++run) {
+                auto chld = std::make_unique<ChildProcess>(start(b,mode.second,grandchildren));
+                const auto t = Clock::now();
+                const auto c = thread_cpu();
+                chld.reset();
+                cpu += thread_cpu()-c;
+                lat.push_back(since(t));
+            }
+            std::sort(lat.begin(),lat.end());
+            std::cout << "  " << std::setw(12) << std::left << b.name << std::setw(9) << mode.first << std::right
+                      << std::setw(6) << lat.size() << std::fixed << std::setprecision(2)
+                      << std::setw(9) << ms(lat.front())
+                      << std::setw(9) << ms(lat[lat.size()/2])
+                      << std::setw(9) << ms(lat[lat.size()*9/10])
+                      << std::setw(9) << ms(lat.back())
+                      << std::setw(9) << ms(cpu/lat.size())
+                      << std::setw(9) << orphans(grandchildren) << "\n";
+        }
+    }
+
+    std::cout << "  bulk: destroying a vector of children (ms)\n"
+              << "  " << std::setw(12) << std::left << "child" << std::setw(9) << "flags" << std::right
+              << std::setw(6) << "count" << std::setw(9) << "total" << std::setw(9) << "each"
+              << std::setw(9) << "cpu" << std::setw(9) << "orphans" << "\n";
+    for(const auto& mode : modes) {
+        for(const auto& b : behaviours) {
+            std::vector<ChildProcess> chld;
+            std::vector<pid_t> grandchildren;
+            for(auto i=0;i<b.bulk;++i) {
+                chld.push_back(start(b,mode.second,grandchildren));
+            }
+            const auto t = Clock::now();
+            const auto c = thread_cpu();
+            chld.clear();
+            const auto cpu = thread_cpu()-c;
+            const auto total = since(t);
+            std::cout << "  " << std::setw(12) << std::left << b.name << std::setw(9) << mode.first << std::right
+                      << std::setw(6) << b.bulk << std::fixed << std::setprecision(2)
+                      << std::setw(9) << ms(total) << std::setw(9) << ms(total/b.bulk)
+                      << std::setw(9) << ms(cpu/b.bulk)
+                      << std::setw(9) << orphans(grandchildren) << "\n";
+        }
+    }
+}
+
+// All benchmarks by name
+const std::map<std::string,std::function<void()>> benchmarks = {
+    { "colocate",   colocate   },
+    { "shell",      shell      },
+    { "teardown",   teardown   },
+    { "textfilter", textfilter }
+};
+
+} // namespace
+
+int main(int argc,char** argv) {
+    if (argc<2) {
+        for(const auto& b : benchmarks) b.second();
+        return EXIT_SUCCESS;
+    }
+
+    for(auto i=1;i<argc;++i) {
+        const auto b = benchmarks.find(argv[i]);
+        if (b==benchmarks.end()) {
+            std::cerr << "Unknown benchmark: " << argv[i] << "\n";
+            return EXIT_FAILURE;
+        }
+        b->second();
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,222 @@
+/**
+ * @brief Child Process Manager performance budget tests
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ *
+ * Counts heap allocations and syscalls in the calling thread for one
+ * ChildProcess spawn and join, and fails if a budget is exceeded. The
+ * budgets below may be overridden with environment variables named
+ * BUDGET_<CASE>_ALLOCS and BUDGET_<CASE>_SYSCALLS (e. g. BUDGET_PLAIN_ALLOCS).
+ *
+ * The syscalls are counted by the wrappers in interpose.cpp. To make sure
+ * that none is missed, the kernel's count is taken as well, with a seccomp
+ * filter that reports every syscall of the measuring thread, and the test
+ * fails if the two differ.
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define BOOST_TEST_MODULE budget
+#include <boost/test/unit_test.hpp>
+
+#include "childprocess.hpp"
+
+// From interpose.cpp
+void count_begin();
+void count_end(unsigned long& nallocs,unsigned long& nsyscalls);
+
+BOOST_AUTO_TEST_SUITE(budget)
+
+namespace {
+
+/*
+ * Get a budget, overridable from the environment.
+ */
+unsigned long budget(const std::string& name,unsigned long dflt) {
+    const auto env = getenv(("BUDGET_" + name).c_str());
+    return env ? std::stoul(env) : dflt;
+}
+
+/*
+ * Kernel's count of the syscalls made by one thread while counting. A
+ * seccomp filter makes the kernel report every syscall of the thread (and
+ * of the processes it starts) to a supervisor thread, which counts those
+ * of the thread and lets them all continue. The supervisor must not
+ * allocate or take locks, since the filtered thread may hold them while
+ * it's waiting.
+ */
+class KernelCount {
+public:
+    static constexpr int max_nr = 1024;
+
+    KernelCount() : supervisor_([this](){ supervise(); }) {}
+
+    ~KernelCount() {
+        stop_ = true;
+        supervisor_.join();
+        if (fd_>=0) close(fd_);
+    }
+
+    // Filter the calling thread from now on. Returns false if seccomp
+    // isn't available.
+    bool install() {
+        tid_ = static_cast<pid_t>(syscall(SYS_gettid));
+        sock_filter filter[] = { BPF_STMT(BPF_RET | BPF_K,SECCOMP_RET_USER_NOTIF) };
+        sock_fprog prog = { 1, filter };
+        if (prctl(PR_SET_NO_NEW_PRIVS,1,0,0,0)) return false;
+        const auto fd = syscall(SYS_seccomp,SECCOMP_SET_MODE_FILTER,SECCOMP_FILTER_FLAG_NEW_LISTENER,&prog);
+        if (fd<0) return false;
+        fd_ = static_cast<int>(fd);
+        return true;
+    }
+
+    // Start and stop counting (without making syscalls)
+    void begin() { counting_ = true; }
+    void end() { counting_ = false; }
+
+    // Number of calls of a syscall, and of all syscalls
+    unsigned long count(int nr) const { return counts_[nr]; }
+    unsigned long total() const {
+        auto ret = 0UL;
+        for(const auto& c : counts_) ret += c;
+        return ret;
+    }
+
+private:
+    std::atomic<int> fd_{-1};
+    std::atomic<pid_t> tid_{0};
+    std::atomic<bool> counting_{false}, stop_{false};
+    std::atomic<unsigned long> counts_[max_nr] = {};
+    std::thread supervisor_;
+
+    void supervise() {
+        while(!stop_) {
+            const auto fd = fd_.load();
+            pollfd pfd = { fd, POLLIN, 0 };
+            if (fd<0 || poll(&pfd,1,10)<=0 || !(pfd.revents & POLLIN)) {
+                if (fd<0 || (pfd.revents & POLLHUP)) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            seccomp_notif req = {};
+            if (ioctl(fd,SECCOMP_IOCTL_NOTIF_RECV,&req)) continue;
+            if (counting_ && static_cast<pid_t>(req.pid)==tid_ && req.data.nr>=0 && req.data.nr<max_nr) {
+                ++counts_[req.data.nr];
+            }
+            seccomp_notif_resp resp = {};
+            resp.id = req.id;
+            resp.flags = SECCOMP_USER_NOTIF_FLAG_CONTINUE;
+            ioctl(fd,SECCOMP_IOCTL_NOTIF_SEND,&resp);
+        }
+    }
+};
+
+/*
+ * Measure the average number of allocations and syscalls of a spawn/join
+ * and compare them to their budgets.
+ */
+void check(const std::string& name,unsigned long allocs,unsigned long syscalls,std::function<void()> fct) {
+
+    // Measure in a thread of its own, which is filtered for the kernel's
+    // count. The first call initializes static data and the thread's
+    // malloc arena.
+    const auto runs = 20UL;
+    auto total_allocs = 0UL, total_syscalls = 0UL;
+    KernelCount kernel;
+    auto filtered = false;
+    std::thread([&](){
+        filtered = kernel.install();
+        fct();
+        for(auto i=0UL;i<runs;++i) {
+            unsigned long a, s;
+            kernel.begin();
+            count_begin();
+            fct();
+            count_end(a,s);
+            kernel.end();
+            total_allocs += a;
+            total_syscalls += s;
+        }
+    }).join();
+
+    // The kernel must have seen no syscalls that weren't counted
+    if (filtered) {
+        std::ostringstream seen;
+        for(auto nr=0;nr<KernelCount::max_nr;++nr) {
+            if (kernel.count(nr)) seen << " " << nr << ":" << kernel.count(nr);
+        }
+        BOOST_TEST_MESSAGE(name << ": kernel saw" << seen.str());
+        BOOST_TEST(kernel.total()==total_syscalls);
+    } else {
+        BOOST_TEST_MESSAGE(name << ": seccomp not available, syscall count not verified");
+    }
+
+    const auto a = total_allocs/runs;
+    const auto s = total_syscalls/runs;
+    BOOST_TEST_MESSAGE(name << ": " << a << " allocations, " << s << " syscalls");
+    BOOST_TEST(a<=budget(name + "_ALLOCS",allocs));
+    BOOST_TEST(s<=budget(name + "_SYSCALLS",syscalls));
+}
+
+} // namespace
+
+/*
+ * Plain spawn and join.
+ */
+BOOST_AUTO_TEST_CASE(plain) {
+    check("PLAIN",3,4,[](){
+        ChildProcess("/bin/true").join();
+    });
+}
+
+/*
+ * Spawn with a precomputed environment.
+ */
+BOOST_AUTO_TEST_CASE(env) {
+    const auto env = EnvBlock({},{ { "BUDGET", "1" } });
+    check("ENV",3,4,[&env](){
+        ChildProcess("/bin/true",{},0,[](){},env).join();
+    });
+}
+
+/*
+ * Spawn with pinned I/O threads, which waits for the exec.
+ */
+BOOST_AUTO_TEST_CASE(pinned) {
+    check("PINNED",3,8,[](){
+        ChildProcess("/bin/true",{},ChildProcess::PINLLC).join();
+    });
+}
+
+/*
+ * Spawn with delay accounting, which queries taskstats in join.
+ */
+BOOST_AUTO_TEST_CASE(delays) {
+    check("DELAYS",3,8,[](){
+        ChildProcess("/bin/true",{},ChildProcess::DELAYS).join();
+    });
+}
+
+/*
+ * Spawn in a process group with a heartbeat, terminated by the dtor.
+ */
+BOOST_AUTO_TEST_CASE(group) {
+    check("GROUP",5,16,[](){
+        ChildProcess("/bin/sleep",{ "10" },ChildProcess::HEARTBEAT | ChildProcess::PGROUP);
+    });
+}
+
+BOOST_AUTO_TEST_SUITE_END()
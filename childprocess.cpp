@@ -6,19 +6,653 @@
  * @copyright MIT license
  */
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
+#include <unistd.h>
+#include <linux/genetlink.h>
+#include <linux/taskstats.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <sys/resource.h>
 #include <sys/wait.h>
 #include <ext/stdio_filebuf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <boost/iostreams/categories.hpp>
 #include <boost/iostreams/stream.hpp>
-#include <boost/iostreams/device/file_descriptor.hpp>
 
 #include "childprocess.hpp"
+#include "heartbeat.hpp"
 
 using namespace std::chrono_literals;
 
+namespace {
+
+/*
+ * Add the CPUs of a sysfs CPU list (e. g. "0-3,8-11") to a CPU set.
+ */
+void read_cpu_list(const std::string& path,cpu_set_t& set) {
+    std::ifstream ifs(path);
+    std::string range;
+    while(std::getline(ifs,range,',')) {
+        int lo = -1, hi = -1;
+        if (sscanf(range.c_str(),"%d-%d",&lo,&hi)<2) hi = lo;
+        for(auto cpu=lo;cpu>=0 && cpu<=hi && cpu<CPU_SETSIZE;++cpu) {
+            CPU_SET(cpu,&set);
+        }
+    }
+}
+
+/*
+ * Get the set of CPUs that share the last-level cache with a CPU. Read from
+ * sysfs once and remembered; CPUs without cache information map to themselves.
+ */
+const cpu_set_t& llc_domain(int cpu) {
+    static const auto domains = [](){
+        std::vector<cpu_set_t> ret(CPU_SETSIZE);
+        for(auto c=0;c<CPU_SETSIZE;++c) {
+            auto& set = ret[c];
+            CPU_ZERO(&set);
+            CPU_SET(c,&set);
+
+            // The LLC is the cache index with the highest level
+            const auto dir = "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/cache/";
+            auto best = 0;
+            std::string list;
+            for(auto idx=0;;++idx) {
+                std::ifstream ifs(dir + "index" + std::to_string(idx) + "/level");
+                auto level = 0;
+                if (!(ifs >> level)) break;
+                if (level>best) {
+                    best = level;
+                    list = dir + "index" + std::to_string(idx) + "/shared_cpu_list";
+                }
+            }
+            if (!list.empty()) read_cpu_list(list,set);
+        }
+        return ret;
+    }();
+    return domains[cpu];
+}
+
+/*
+ * Pin the calling I/O thread to the CPUs the child process may run on
+ * (PINCORE), or to all CPUs sharing a last-level cache with them (PINLLC),
+ * so that piped data doesn't have to travel between caches or sockets.
+ * Failure is not an error; the thread simply runs wherever it likes.
+ */
+void pin_to_child(pid_t pid,int flags) {
+    if (!(flags & (ChildProcess::PINCORE | ChildProcess::PINLLC))) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(pid,sizeof(set),&set)) return;
+
+    if (flags & ChildProcess::PINLLC) {
+        const auto child = set;
+        for(auto cpu=0;cpu<CPU_SETSIZE;++cpu) {
+            if (CPU_ISSET(cpu,&child)) {
+                CPU_OR(&set,&set,&llc_domain(cpu));
+            }
+        }
+    }
+
+    pthread_setaffinity_np(pthread_self(),sizeof(set),&set);
+}
+
+/*
+ * PIDs of all running child processes, i. e. started and not yet waited for.
+ */
+struct Registry {
+    std::mutex mutex;
+    std::unordered_set<pid_t> pids;
+};
+
+Registry& registry() {
+    static Registry reg;
+    return reg;
+}
+
+void track(pid_t pid) {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> _(reg.mutex);
+    reg.pids.insert(pid);
+}
+
+void untrack(pid_t pid) {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> _(reg.mutex);
+    reg.pids.erase(pid);
+}
+
+/*
+ * Heartbeat counters of the child processes started with HEARTBEAT. Each
+ * is in a memfd of its own that only its process gets, so no process can
+ * touch another one's counter. The parent keeps them mapped, so they can
+ * be scanned in one pass without any syscalls.
+ */
+struct Heartbeats {
+    std::mutex mutex;
+    std::unordered_map<pid_t,std::atomic<unsigned long long>*> pids;
+};
+
+Heartbeats& beat_table() {
+    static Heartbeats hb;
+    return hb;
+}
+
+// Value of the heartbeat environment variable (see heartbeat.hpp)
+const std::string beat_env = std::to_string(Heartbeat::fd);
+
+/*
+ * Heartbeat counter of a new child process: a memfd of one page and the
+ * parent's mapping of it. The mapping is unmapped in the dtor, unless it
+ * was handed over to the table with `track`.
+ */
+class BeatCounter {
+public:
+    BeatCounter() {
+        fd_ = memfd_create("childprocess-heartbeat",MFD_CLOEXEC);
+        if (fd_<0 || ftruncate(fd_,size())!=0) {
+            throw std::runtime_error("Error " + std::to_string(errno) + " creating the heartbeat memfd");
+        }
+        const auto p = mmap(nullptr,size(),PROT_READ | PROT_WRITE,MAP_SHARED,fd_,0);
+        if (p==MAP_FAILED) {
+            throw std::runtime_error("Error " + std::to_string(errno) + " mapping the heartbeat memfd");
+        }
+        counter_ = static_cast<std::atomic<unsigned long long>*>(p);
+    }
+
+    ~BeatCounter() {
+        if (counter_) munmap(counter_,size());
+        if (fd_>=0) close(fd_);
+    }
+
+    BeatCounter(const BeatCounter&) = delete;
+    BeatCounter& operator=(const BeatCounter&) = delete;
+
+    int fd() const { return fd_; }
+
+    // Hand the counter over to the table
+    void track(pid_t pid) {
+        auto& hb = beat_table();
+        std::lock_guard<std::mutex> _(hb.mutex);
+        hb.pids[pid] = std::exchange(counter_,nullptr);
+    }
+
+    // Remove a process' counter from the table
+    static void untrack(pid_t pid) {
+        auto& hb = beat_table();
+        std::lock_guard<std::mutex> _(hb.mutex);
+        const auto p = hb.pids.find(pid);
+        if (p!=hb.pids.end()) {
+            munmap(p->second,size());
+            hb.pids.erase(p);
+        }
+    }
+
+private:
+    int fd_ = -1;
+    std::atomic<unsigned long long>* counter_ = nullptr;
+
+    static size_t size() {
+        static const auto ret = size_t(sysconf(_SC_PAGESIZE));
+        return ret;
+    }
+};
+
+/*
+ * Minimal generic netlink client for the taskstats interface.
+ */
+class Netlink {
+public:
+    Netlink() : fd_(socket(AF_NETLINK,SOCK_RAW | SOCK_CLOEXEC,NETLINK_GENERIC)) {}
+    ~Netlink() { if (fd_>=0) close(fd_); }
+
+    // Send a request with one attribute, receive the reply into buf_
+    bool request(uint16_t family,uint8_t cmd,uint16_t attr,const void* data,size_t len) {
+        struct {
+            nlmsghdr nl;
+            genlmsghdr genl;
+            char attrs[64];
+        } msg = {};
+        auto na = reinterpret_cast<nlattr*>(msg.attrs);
+        na->nla_type = attr;
+        na->nla_len = NLA_HDRLEN + len;
+        memcpy(reinterpret_cast<char*>(na)+NLA_HDRLEN,data,len);
+        msg.nl.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN) + NLA_ALIGN(na->nla_len);
+        msg.nl.nlmsg_type = family;
+        msg.nl.nlmsg_flags = NLM_F_REQUEST;
+        msg.nl.nlmsg_pid = 0;
+        msg.genl.cmd = cmd;
+        msg.genl.version = 1;
+
+        sockaddr_nl addr = {};
+        addr.nl_family = AF_NETLINK;
+        if (fd_<0 || sendto(fd_,&msg,msg.nl.nlmsg_len,0,reinterpret_cast<sockaddr*>(&addr),sizeof(addr))<0) {
+            return false;
+        }
+
+        const auto n = recv(fd_,buf_,sizeof(buf_),0);
+        const auto nl = reinterpret_cast<const nlmsghdr*>(buf_);
+        return n>0 && NLMSG_OK(nl,size_t(n)) && nl->nlmsg_type!=NLMSG_ERROR;
+    }
+
+    // Find an attribute in a range of attributes
+    static const nlattr* find(const char* begin,const char* end,uint16_t type) {
+        while(begin+NLA_HDRLEN<=end) {
+            const auto na = reinterpret_cast<const nlattr*>(begin);
+            if (na->nla_len<NLA_HDRLEN) break;
+            if ((na->nla_type & NLA_TYPE_MASK)==type) return na;
+            begin += NLA_ALIGN(na->nla_len);
+        }
+        return nullptr;
+    }
+
+    // First/last attribute byte of the reply
+    const char* begin() const { return buf_ + NLMSG_LENGTH(GENL_HDRLEN); }
+    const char* end() const { return buf_ + reinterpret_cast<const nlmsghdr*>(buf_)->nlmsg_len; }
+
+private:
+    int fd_;
+    alignas(nlmsghdr) char buf_[4096];
+};
+
+/*
+ * Get the taskstats of a process that has terminated but not yet been
+ * reaped. Queried by PID: the kernel's per-thread-group query skips
+ * threads that have exited, so it has nothing for a zombie. The result is
+ * that of the main thread.
+ */
+ChildProcess::Delays get_delays(pid_t pid) {
+    ChildProcess::Delays ret;
+    Netlink nl;
+
+    // Resolve the taskstats family ID once
+    static const uint16_t family = [](){
+        Netlink nl;
+        if (!nl.request(GENL_ID_CTRL,CTRL_CMD_GETFAMILY,CTRL_ATTR_FAMILY_NAME,
+            TASKSTATS_GENL_NAME,sizeof(TASKSTATS_GENL_NAME))) return 0;
+        const auto id = Netlink::find(nl.begin(),nl.end(),CTRL_ATTR_FAMILY_ID);
+        return id ? *reinterpret_cast<const uint16_t*>(reinterpret_cast<const char*>(id)+NLA_HDRLEN) : 0;
+    }();
+    if (!family) return ret;
+
+    const uint32_t id = pid;
+    if (!nl.request(family,TASKSTATS_CMD_GET,TASKSTATS_CMD_ATTR_PID,&id,sizeof(id))) return ret;
+
+    // Reply: AGGR_PID { PID, STATS }
+    const auto aggr = Netlink::find(nl.begin(),nl.end(),TASKSTATS_TYPE_AGGR_PID);
+    if (!aggr) return ret;
+    const auto inner = reinterpret_cast<const char*>(aggr)+NLA_HDRLEN;
+    const auto stats = Netlink::find(inner,reinterpret_cast<const char*>(aggr)+aggr->nla_len,TASKSTATS_TYPE_STATS);
+    if (!stats) return ret;
+
+    taskstats ts = {};
+    memcpy(&ts,reinterpret_cast<const char*>(stats)+NLA_HDRLEN,
+        std::min(sizeof(ts),size_t(stats->nla_len-NLA_HDRLEN)));
+
+    ret.valid        = true;
+    ret.cpu          = std::chrono::nanoseconds(ts.cpu_delay_total);
+    ret.blkio        = std::chrono::nanoseconds(ts.blkio_delay_total);
+    ret.swapin       = std::chrono::nanoseconds(ts.swapin_delay_total);
+    ret.cpu_count    = ts.cpu_count;
+    ret.blkio_count  = ts.blkio_count;
+    ret.swapin_count = ts.swapin_count;
+    return ret;
+}
+
+// Buffer size for reading chunks (the default pipe capacity)
+const std::streamsize chunk_size = 65536;
+
+/*
+ * I/O statistics of all child processes.
+ */
+ChildProcess::IoStats& total_io() {
+    static ChildProcess::IoStats stats;
+    return stats;
+}
+
+/*
+ * Statistics of all child processes.
+ */
+ChildProcess::Stats& process_stats() {
+    static ChildProcess::Stats stats;
+    return stats;
+}
+
+/*
+ * Backend installed with ChildProcess::install. `any` tells without
+ * locking if there is one at all, so the native case stays cheap.
+ */
+struct Backends {
+    std::mutex mutex;
+    std::shared_ptr<ChildProcess::Backend> backend;
+    std::atomic<bool> any{false};
+};
+
+Backends& backends() {
+    static Backends inst;
+    return inst;
+}
+
+std::shared_ptr<ChildProcess::Backend> installed_backend() {
+    auto& inst = backends();
+    if (!inst.any.load(std::memory_order_acquire)) return nullptr;
+    std::lock_guard<std::mutex> _(inst.mutex);
+    return inst.backend;
+}
+
+/*
+ * Create a pipe. Close-on-exec, so that other child processes don't
+ * inherit it; dup2 in the child clears the flag.
+ */
+void make_pipe(int fds[2]) {
+    if (pipe2(fds,O_CLOEXEC)) {
+        const auto err = errno;
+        throw std::runtime_error("Error " + std::to_string(err) + " creating the pipe");
+    }
+}
+
+/*
+ * Counts the running I/O threads during its lifetime.
+ */
+struct IoThread {
+    IoThread()  { process_stats().io_threads.fetch_add(1,std::memory_order_relaxed); }
+    ~IoThread() { process_stats().io_threads.fetch_sub(1,std::memory_order_relaxed); }
+};
+
+/*
+ * Blocks SIGPIPE in the calling thread during its lifetime, so that writing
+ * into a pipe whose reader is gone fails with EPIPE instead of killing the
+ * process.
+ */
+class NoSigpipe {
+public:
+    NoSigpipe() {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set,SIGPIPE);
+        pthread_sigmask(SIG_BLOCK,&set,&old_);
+    }
+
+    ~NoSigpipe() {
+        pthread_sigmask(SIG_SETMASK,&old_,nullptr);
+    }
+
+    // Discard the SIGPIPE raised by a write that failed with EPIPE, so it
+    // isn't delivered when the signal is unblocked
+    static void discard() {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set,SIGPIPE);
+        const timespec zero = { 0, 0 };
+        while(sigtimedwait(&set,nullptr,&zero)<0 && errno==EINTR) {}
+    }
+
+private:
+    sigset_t old_;
+};
+
+/*
+ * Add to an I/O counter of a child process and to the total.
+ */
+void count(std::atomic<unsigned long long> ChildProcess::IoStats::*counter,ChildProcess::IoStats& stats,unsigned long long n=1) {
+    (stats.*counter).fetch_add(n,std::memory_order_relaxed);
+    (total_io().*counter).fetch_add(n,std::memory_order_relaxed);
+}
+
+/*
+ * Raise the maximum pipe fill level of a child process and the total.
+ */
+void count_fill(ChildProcess::IoStats& stats,unsigned long long fill) {
+    for(auto m : { &stats.max_fill, &total_io().max_fill }) {
+        auto cur = m->load(std::memory_order_relaxed);
+        while(fill>cur && !m->compare_exchange_weak(cur,fill,std::memory_order_relaxed)) {}
+    }
+}
+
+/*
+ * Boost.Iostreams device that reads from a pipe, counting what it does.
+ * Closes the fd when the stream is closed.
+ */
+class PipeSource {
+public:
+    typedef char char_type;
+    struct category : boost::iostreams::source_tag, boost::iostreams::closable_tag {};
+
+    PipeSource(int fd,std::shared_ptr<ChildProcess::IoStats> stats) : fd_(fd), stats_(std::move(stats)) {}
+
+    std::streamsize read(char* s,std::streamsize n) {
+        for(;;) {
+            const auto ret = ::read(fd_,s,n);
+            count(&ChildProcess::IoStats::reads,*stats_);
+            if (ret>0) {
+                count(&ChildProcess::IoStats::bytes_read,*stats_,ret);
+
+                // Buffer full: find out how much more is waiting in the pipe
+                int more = 0;
+                if (ret==n) ioctl(fd_,FIONREAD,&more);
+                count_fill(*stats_,ret+more);
+                return ret;
+            }
+            if (ret==0) return -1;
+            if (errno==EINTR) continue;
+            if (errno==EAGAIN) {
+                count(&ChildProcess::IoStats::eagains,*stats_);
+                wait(POLLIN);
+                continue;
+            }
+            throw std::ios_base::failure("Error " + std::to_string(errno) + " reading from the pipe");
+        }
+    }
+
+    void close() {
+        ::close(fd_);
+    }
+
+protected:
+    int fd_;
+    std::shared_ptr<ChildProcess::IoStats> stats_;
+
+    // Wait until a non-blocking fd is ready
+    void wait(short events) {
+        pollfd pfd = { fd_, events, 0 };
+        poll(&pfd,1,-1);
+    }
+};
+
+/*
+ * Boost.Iostreams device that writes into a pipe, counting what it does.
+ * Closes the fd when the stream is closed.
+ */
+class PipeSink : private PipeSource {
+public:
+    typedef char char_type;
+    struct category : boost::iostreams::sink_tag, boost::iostreams::closable_tag {};
+
+    using PipeSource::PipeSource;
+    using PipeSource::close;
+
+    std::streamsize write(const char* s,std::streamsize n) {
+        if (closed_) throw ChildProcess::StdinClosed();
+        auto done = std::streamsize(0);
+        while(done<n) {
+            const auto ret = ::write(fd_,s+done,n-done);
+            count(&ChildProcess::IoStats::writes,*stats_);
+            if (ret>=0) {
+                count(&ChildProcess::IoStats::bytes_written,*stats_,ret);
+                if (ret<n-done) count(&ChildProcess::IoStats::partial_writes,*stats_);
+                done += ret;
+                continue;
+            }
+            if (errno==EINTR) continue;
+            if (errno==EAGAIN) {
+                count(&ChildProcess::IoStats::eagains,*stats_);
+                wait(POLLOUT);
+                continue;
+            }
+            failed();
+        }
+        return n;
+    }
+
+    // Write as much as fits into the pipe without waiting (fd must be non-blocking)
+    std::streamsize write_some(const char* s,std::streamsize n) {
+        for(;;) {
+            const auto ret = ::write(fd_,s,n);
+            count(&ChildProcess::IoStats::writes,*stats_);
+            if (ret>=0) {
+                count(&ChildProcess::IoStats::bytes_written,*stats_,ret);
+                if (ret<n) count(&ChildProcess::IoStats::partial_writes,*stats_);
+                return ret;
+            }
+            if (errno==EINTR) continue;
+            if (errno==EAGAIN) {
+                count(&ChildProcess::IoStats::eagains,*stats_);
+                return 0;
+            }
+            failed();
+        }
+    }
+
+private:
+    bool closed_ = false;               // The process closed its end
+
+    // Throw after a failed write; the caller must have blocked SIGPIPE (see NoSigpipe)
+    [[noreturn]] void failed() {
+        const auto err = errno;
+        if (err==EPIPE) {
+            closed_ = true;
+            NoSigpipe::discard();
+            count(&ChildProcess::IoStats::epipes,*stats_);
+            throw ChildProcess::StdinClosed();
+        }
+        throw std::ios_base::failure("Error " + std::to_string(err) + " writing into the pipe");
+    }
+};
+
+} // namespace
+
+/*
+ * Materialized environment: all "NAME=value" strings back to back in one
+ * buffer, and the null-terminated pointer array into it.
+ */
+struct EnvBlock::Block {
+    std::vector<char> data;
+    std::vector<char*> ptrs;
+    mutable std::once_flag beat_once;                   // For `beat`
+    mutable std::shared_ptr<const Block> beat;          // With the heartbeat variable
+};
+
+/**
+ * Make an environment by changing some variables of another one.
+ *
+ * @param base Environment to start with. If default-constructed, the
+ *             current environment is used.
+ * @param overlay Variables to set (name and value) or remove (name and nullopt).
+ */
+EnvBlock::EnvBlock(const EnvBlock& base,const Overlay& overlay) {
+    const auto& from = base.block_ ? base : current();
+
+    // Collect the resulting variables, keeping the base's order
+    std::vector<std::string> vars;
+    for(auto p=from.envp();*p;++p) {
+        const auto eq = strchr(*p,'=');
+        const auto name = std::string(*p,eq ? eq-*p : strlen(*p));
+        const auto o = std::find_if(overlay.begin(),overlay.end(),[&name](const auto& v){ return v.first==name; });
+        if (o==overlay.end()) vars.emplace_back(*p);
+    }
+    for(const auto& o : overlay) {
+        if (o.second) vars.push_back(o.first + "=" + *o.second);
+    }
+
+    // Put them into one block
+    auto block = std::make_shared<Block>();
+    auto size = size_t(0);
+    for(const auto& v : vars) size += v.size()+1;
+    block->data.resize(size);
+    auto pos = block->data.data();
+    for(const auto& v : vars) {
+        block->ptrs.push_back(pos);
+        memcpy(pos,v.c_str(),v.size()+1);
+        pos += v.size()+1;
+    }
+    block->ptrs.push_back(nullptr);
+    block_ = std::move(block);
+}
+
+/**
+ * Take a snapshot of the current environment.
+ */
+EnvBlock EnvBlock::current() {
+    auto block = std::make_shared<Block>();
+    auto size = size_t(0);
+    for(auto p=environ;p && *p;++p) size += strlen(*p)+1;
+    block->data.resize(size);
+    auto pos = block->data.data();
+    for(auto p=environ;p && *p;++p) {
+        const auto len = strlen(*p)+1;
+        block->ptrs.push_back(pos);
+        memcpy(pos,*p,len);
+        pos += len;
+    }
+    block->ptrs.push_back(nullptr);
+
+    EnvBlock ret;
+    ret.block_ = std::move(block);
+    return ret;
+}
+
+/**
+ * Get the environment in the form required by execve.
+ *
+ * @returns the null-terminated array of "NAME=value" strings, or nullptr if
+ * this object stands for the parent's environment.
+ */
+char* const* EnvBlock::envp() const {
+    return block_ ? block_->ptrs.data() : nullptr;
+}
+
+/*
+ * Get the environment with the heartbeat variable set (see HEARTBEAT).
+ * Its value is always the same, so it's made only once.
+ */
+EnvBlock EnvBlock::with_heartbeat() const {
+    std::call_once(block_->beat_once,[this](){
+        block_->beat = EnvBlock(*this,{{ Heartbeat::env, beat_env }}).block_;
+    });
+    EnvBlock ret;
+    ret.block_ = block_->beat;
+    return ret;
+}
+
+/**
+ * Get the value of a variable.
+ *
+ * @returns the value, or nullptr if the variable isn't set.
+ */
+const char* EnvBlock::get(const std::string& name) const {
+    if (!block_) return getenv(name.c_str());
+    for(auto p=envp();*p;++p) {
+        if (strncmp(*p,name.c_str(),name.size())==0 && (*p)[name.size()]=='=') {
+            return *p + name.size() + 1;
+        }
+    }
+    return nullptr;
+}
+
 /**
  * Run a program in a child process.
  *
@@ -37,16 +671,43 @@ using namespace std::chrono_literals;
  * be called after the ChildProcess ctor has already returned.
  *
  * Note that no shell is involved, so putting something like ">filename" into args
- * will not work. If you need to execute a shell command, set `exe` to "/bin/sh" and
+ * will not work. If you need to execute a shell command, use the Pipeline class
+ * (see pipeline.hpp) for simple command lines, or set `exe` to "/bin/sh" and
  * args to something like { "-c", "your | command >your.output" }.
  *
  * @param exe Full path name of the program to execute.
  * @param args Command line arguments (excluding the program name). May be empty or omitted.
- * @param flags Combination of IN, OUT, and ERR; determine which fds are available for piping.
+ * If `flags` contains PINCORE or PINLLC, the threads created by `make_stdin`, `get_stdout`,
+ * and `get_stderr` run on the same CPUs as the child process, or on all CPUs sharing a
+ * last-level cache with them, respectively. The child's CPU affinity may be set in `init`;
+ * the ctor then doesn't return before `init` has finished and the program was started.
+ *
+ * If `flags` contains DELAYS, `join` collects the child's delay accounting
+ * (scheduler, block I/O, and swap-in delays) via the taskstats netlink interface,
+ * available afterwards from `delays`. This requires a kernel with delay accounting
+ * enabled (kernel.task_delayacct=1 or the delayacct boot parameter); otherwise
+ * all delays are zero.
+ *
+ * If `flags` contains HEARTBEAT, the child gets a shared memory counter of its own
+ * (a memfd as fd Heartbeat::fd) that it increments with Heartbeat::beat() (see
+ * heartbeat.hpp), and the parent reads with `beats`, or ProcessMonitor::on_stall watches.
+ *
+ * If `flags` contains PGROUP, the child becomes the leader of a new process group,
+ * which its descendants inherit, so that `pause`, `resume`, and the termination
+ * signals sent by the dtor affect them as well.
+ * See JobGroup (jobgroup.hpp) for pausing several processes at once.
+ *
+ * @param flags Combination of IN, OUT, and ERR (determine which fds are available for piping),
+ *              PINCORE or PINLLC, DELAYS, HEARTBEAT, and PGROUP.
  * @param init Initialization function, invoked in the child process. May throw.
+ * @param env Environment of the new program. Default is the parent's environment
+ *            including changes made by `init`; otherwise these changes are ignored.
  *
  * @throws std::exception if an error occurs.
  *
+ * If a backend was installed with `install`, it starts the process instead, and
+ * may or may not honour `init`, `env`, and the flags other than IN, OUT, and ERR.
+ *
  * If an error occurs executing the program, the child process writes a message to cerr
  * and terminates. In this case, no exception is thrown (the ctor has already returned
  * in the calling process).
@@ -55,21 +716,33 @@ ChildProcess::ChildProcess(
     const std::string& exe,
     std::vector<std::string> const& args,
     int flags,
-    std::function<void()> init
+    std::function<void()> init,
+    EnvBlock env
+
+) : flags_(flags), io_(std::make_shared<IoStats>()) {
+    const auto start = std::chrono::steady_clock::now();
+
+    // Let an installed backend start the process
+    backend_ = installed_backend();
+    if (backend_) {
+        spawn(exe,args,init,env);
+        return;
+    }
 
-) {
     // Make sure the executable exists
     if (!std::filesystem::exists(exe)) {
         throw std::runtime_error("Executable not found: " + exe);
     }
 
-    // Local function to create a pipe
-    auto make_pipe = [](int fds[2]){
-        if (pipe(fds)) {
-            const auto err = errno;
-            throw std::runtime_error("Error " + std::to_string(err) + " creating the pipe");
-        }
-    };
+    // Pipe to synchronize with the child's exec (see below)
+    int sync[2] = { -1, -1 };
+
+    // Heartbeat counter, passed to the child as fd Heartbeat::fd
+    std::optional<BeatCounter> beat;
+    if (flags & HEARTBEAT) {
+        beat.emplace();
+        if (env.envp()) env = env.with_heartbeat();
+    }
 
     // The following must not run more than once at the same time.
     // pipe and fork or both together or whatever seem not to be
@@ -85,16 +758,46 @@ ChildProcess::ChildProcess(
         if (flags & OUT) { make_pipe(pipeout_); }
         if (flags & ERR) { make_pipe(pipeerr_); }
 
+        // When pinning I/O threads, we wait until the child has exec'd
+        // to get its final CPU affinity. The close-on-exec pipe reports EOF then.
+        if (flags & (PINCORE | PINLLC)) {
+            if (pipe2(sync,O_CLOEXEC)) {
+                const auto err = errno;
+                throw std::runtime_error("Error " + std::to_string(err) + " creating the pipe");
+            }
+        }
+
         // Make a new process
         pid_ = fork();
+
+        // Close the child's pipe ends before another thread can fork and
+        // pass copies on to its own child: until that one execs, our child
+        // wouldn't see EOF on stdin and we wouldn't see it on the sync pipe
+        if (pid_>0) {
+            if (flags & IN)  { close(pipein_[0]);  }
+            if (flags & OUT) { close(pipeout_[1]); }
+            if (flags & ERR) { close(pipeerr_[1]); }
+            if (sync[1] >= 0) { close(sync[1]); }
+        }
     }
 
     switch(pid_) {
         default: {
             // Parent process
-            if (flags & IN)  { close(pipein_[0]);  }
-            if (flags & OUT) { close(pipeout_[1]); }
-            if (flags & ERR) { close(pipeerr_[1]); }
+            track(pid_);
+            if (flags & PGROUP) setpgid(pid_,pid_);     // Also done by the child; whoever is first
+            if (beat) beat->track(pid_);
+
+            // Wait for the child to exec (or to die)
+            if (sync[0] >= 0) {
+                char c;
+                while(read(sync[0],&c,1)<0 && errno==EINTR) {}
+                close(sync[0]);
+            }
+
+            auto& stats = process_stats();
+            stats.spawns.fetch_add(1,std::memory_order_relaxed);
+            stats.spawn_latency.add(std::chrono::steady_clock::now()-start);
             break;
         }
 
@@ -102,9 +805,18 @@ ChildProcess::ChildProcess(
             // Child process
 
             // Handle the pipes
-            if (flags & IN)  { close(pipein_[1]);  dup2(pipein_[0],  STDIN_FILENO);  }
-            if (flags & OUT) { close(pipeout_[0]); dup2(pipeout_[1], STDOUT_FILENO); }
-            if (flags & ERR) { close(pipeerr_[0]); dup2(pipeerr_[1], STDERR_FILENO); }
+            const auto redirect = [](int from,int to) {
+                if (from==to) fcntl(to,F_SETFD,0); else dup2(from,to);
+            };
+            if (flags & IN)  { close(pipein_[1]);  redirect(pipein_[0],  STDIN_FILENO);  }
+            if (flags & OUT) { close(pipeout_[0]); redirect(pipeout_[1], STDOUT_FILENO); }
+            if (flags & ERR) { close(pipeerr_[0]); redirect(pipeerr_[1], STDERR_FILENO); }
+            if (sync[0] >= 0) { close(sync[0]); }
+            if (flags & PGROUP) setpgid(0,0);
+            if (beat) {
+                redirect(beat->fd(),Heartbeat::fd);
+                setenv(Heartbeat::env,beat_env.c_str(),1);
+            }
 
             // Run the initialization function
             try {
@@ -127,7 +839,11 @@ ChildProcess::ChildProcess(
             argv[i] = nullptr;
 
             // Run the executable
-            execv(exe.c_str(),argv.get());
+            if (const auto envp = env.envp()) {
+                execve(exe.c_str(),argv.get(),envp);
+            } else {
+                execv(exe.c_str(),argv.get());
+            }
 
             // Failed
             const int err = errno;
@@ -139,56 +855,179 @@ ChildProcess::ChildProcess(
             // Failure
             pid_ = 0;
             const auto err = errno;
+            if (sync[0] >= 0) { close(sync[0]); close(sync[1]); }
             throw std::runtime_error("Error " + std::to_string(err) + " forking a new process");
         }
     }
 }
 
+/**
+ * Start a process through a specific backend instead of the installed one
+ * (or the native fork/exec), e. g. a pre-initialized copy of a TemplateWorker
+ * (see templateworker.hpp).
+ *
+ * @param backend The backend that starts the process.
+ * @param exe,args,flags See above; what the backend does with them is up to it.
+ *
+ * @throws std::exception if an error occurs.
+ */
+ChildProcess::ChildProcess(
+    std::shared_ptr<Backend> backend,
+    const std::string& exe,
+    std::vector<std::string> const& args,
+    int flags
+) : flags_(flags), io_(std::make_shared<IoStats>()), backend_(std::move(backend)) {
+    spawn(exe,args,[](){},EnvBlock());
+}
+
+/*
+ * Start the process through the backend, with the pipes requested by the flags.
+ */
+void ChildProcess::spawn(
+    const std::string& exe,
+    const std::vector<std::string>& args,
+    const std::function<void()>& init,
+    const EnvBlock& env
+) {
+    const auto start = std::chrono::steady_clock::now();
+    if (flags_ & IN)  { make_pipe(pipein_);  }
+    if (flags_ & OUT) { make_pipe(pipeout_); }
+    if (flags_ & ERR) { make_pipe(pipeerr_); }
+
+    const int fds[3] = { pipein_[0], pipeout_[1], pipeerr_[1] };
+    try {
+        pid_ = backend_->spawn(exe,args,flags_,init,env,fds);
+    } catch(...) {
+        for(auto p : { pipein_, pipeout_, pipeerr_ }) {
+            for(auto i=0;i<2;++i) if (p[i]>=0) close(p[i]);
+        }
+        throw;
+    }
+
+    // The backend has its own copies of the child's ends
+    for(auto fd : { &pipein_[0], &pipeout_[1], &pipeerr_[1] }) {
+        if (*fd>=0) close(*fd);
+    }
+
+    auto& stats = process_stats();
+    stats.spawns.fetch_add(1,std::memory_order_relaxed);
+    stats.spawn_latency.add(std::chrono::steady_clock::now()-start);
+}
+
 /**
  * Move constructor for ChildProcess.
  */
 ChildProcess::ChildProcess(ChildProcess &&rhs) noexcept {
     std::swap(pid_,      rhs.pid_);
+    std::swap(flags_,    rhs.flags_);
     std::swap(pipein_,   rhs.pipein_);
     std::swap(pipeout_,  rhs.pipeout_);
     std::swap(pipeerr_,  rhs.pipeerr_);
+    std::swap(delays_,   rhs.delays_);
+    std::swap(usage_,    rhs.usage_);
+    std::swap(io_,       rhs.io_);
+    std::swap(backend_,  rhs.backend_);
 }
 
 /**
  * Terminate the process that was started in the constructor by sending SIGTERM.
  * Then, wait for the process to finish. If the process doesn't exit within 3
- * seconds, terminate it with SIGKILL.
+ * seconds, terminate it with SIGKILL. With PGROUP, the signals go to the whole
+ * process group, and whatever is left of it when the leader has exited is
+ * killed with SIGKILL.
  */
 ChildProcess::~ChildProcess() {
-    if (pid_) {
-        // Tell the child to terminate
-        kill(pid_,SIGTERM);
+    // Close the pipes that weren't used
+    for(auto fd : { &pipein_[1], &pipeout_[0], &pipeerr_[0] }) {
+        if (*fd>=0) close(*fd);
+    }
 
-        // Give it some time to do so
-        for(int count=300;count>=0;--count) {
-            if (waitpid(pid_,nullptr,WNOHANG)!=0) return;
-            std::this_thread::sleep_for(10ms);
+    if (pid_ && backend_) {
+        const auto start = std::chrono::steady_clock::now();
+        // Same procedure as below, through the backend
+        backend_->signal(pid_,SIGTERM);
+        auto done = false;
+        for(int count=300;count>=0 && !done;--count) {
+            done = backend_->wait(pid_,true).has_value();
+            if (!done) std::this_thread::sleep_for(10ms);
         }
+        if (!done) {
+            backend_->signal(pid_,SIGKILL);
+            backend_->wait(pid_,false);
+        }
+        process_stats().reap_latency.add(std::chrono::steady_clock::now()-start);
+    } else if (pid_) {
+        // Not running any more as far as others are concerned
+        untrack(pid_);
+        BeatCounter::untrack(pid_);
+        const auto start = std::chrono::steady_clock::now();
+        const auto reaped = [start](){
+            process_stats().reap_latency.add(std::chrono::steady_clock::now()-start);
+        };
+
+        // Tell the child to terminate (continuing it in case it was paused);
+        // with PGROUP, its whole group, which `pause` may have stopped too
+        const auto target = flags_ & PGROUP ? -pid_ : pid_;
+        kill(target,SIGTERM);
+        kill(target,SIGCONT);
 
-        // Didn't terminate in time, kill it
-        kill(pid_,SIGKILL);
+        // Give it some time to do so. With PGROUP, the leader is left as a
+        // zombie, so that the group ID can't be reused before what's left
+        // of the group has been killed below.
+        const auto options = WEXITED | WNOHANG | (flags_ & PGROUP ? WNOWAIT : 0);
+        auto done = false;
+        for(int count=300;count>=0 && !done;--count) {
+            siginfo_t info;
+            info.si_pid = 0;
+            done = waitid(P_PID,pid_,&info,options)==0 && info.si_pid==pid_;
+            if (!done) std::this_thread::sleep_for(10ms);
+        }
 
-        // Zombie trap
-        waitpid(pid_,nullptr,0);
+        // Didn't terminate in time, or left descendants behind: kill them
+        if (!done || (flags_ & PGROUP)) {
+            kill(target,SIGKILL);
+
+            // Zombie trap
+            waitpid(pid_,nullptr,0);
+        }
+        reaped();
     }
 }
 
 /**
- * Wait for the child process to terminate.
+ * Wait for the child process to terminate. Collects its resource usage
+ * (see `usage`), and with DELAYS its delay accounting.
  *
  * @returns the process' exit status (-1 if not available).
  */
 int ChildProcess::join() {
     int ret = -1;
 
-    if (pid_) {
-        if (waitpid(pid_,&ret,0)==pid_) {
+    if (pid_ && backend_) {
+        if (const auto status = backend_->wait(pid_,false)) {
+            ret = *status;
+            pid_ = 0;
+        }
+    } else if (pid_) {
+        // Wait for termination, but leave the zombie so the PID can't be
+        // reused before we've removed it from the list of running processes
+        siginfo_t info;
+        while(waitid(P_PID,pid_,&info,WEXITED | WNOWAIT)<0 && errno==EINTR) {}
+        untrack(pid_);
+        BeatCounter::untrack(pid_);
+
+        // Get delay accounting from the zombie
+        if (flags_ & DELAYS) {
+            delays_ = get_delays(pid_);
+        }
+
+        rusage ru;
+        if (wait4(pid_,&ret,0,&ru)==pid_) {
             pid_ = 0;
+            usage_.valid = true;
+            usage_.user = std::chrono::seconds(ru.ru_utime.tv_sec) + std::chrono::microseconds(ru.ru_utime.tv_usec);
+            usage_.system = std::chrono::seconds(ru.ru_stime.tv_sec) + std::chrono::microseconds(ru.ru_stime.tv_usec);
+            usage_.max_rss = static_cast<unsigned long long>(ru.ru_maxrss)*1024;
         }
     }
 
@@ -196,15 +1035,142 @@ int ChildProcess::join() {
 }
 
 /**
- * Get a file descriptor of a pipe connected to the process.
+ * Install a backend that starts and controls all child processes created
+ * from now on, instead of fork/exec/kill/waitpid. Processes that are
+ * already running keep using the backend they were started with.
+ *
+ * @param backend The backend to use, or nullptr for the native one.
+ *
+ * @returns the backend that was installed before.
+ */
+std::shared_ptr<ChildProcess::Backend> ChildProcess::install(std::shared_ptr<Backend> backend) {
+    auto& inst = backends();
+    std::lock_guard<std::mutex> _(inst.mutex);
+    std::swap(inst.backend,backend);
+    inst.any = !!inst.backend;
+    return backend;
+}
+
+/**
+ * Get the statistics of all child processes together.
+ */
+const ChildProcess::Stats& ChildProcess::stats() {
+    return process_stats();
+}
+
+/**
+ * Add a value to a histogram.
+ */
+void ChildProcess::Histogram::add(std::chrono::nanoseconds value) {
+    const auto secs = std::chrono::duration<double>(value).count();
+    const auto bucket = std::lower_bound(std::begin(bounds),std::end(bounds),secs) - std::begin(bounds);
+    counts[bucket].fetch_add(1,std::memory_order_relaxed);
+    sum_ns.fetch_add(value.count(),std::memory_order_relaxed);
+}
+
+/**
+ * Get the I/O statistics of all child processes together.
+ */
+const ChildProcess::IoStats& ChildProcess::total_io_stats() {
+    return total_io();
+}
+
+/**
+ * Get the PIDs of all running child processes, i. e. those started by
+ * a ChildProcess object and not yet waited for.
+ */
+std::vector<pid_t> ChildProcess::live() {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> _(reg.mutex);
+    return std::vector<pid_t>(reg.pids.begin(),reg.pids.end());
+}
+
+/**
+ * Send a signal to a running child process. Safe against PID reuse: does
+ * nothing if the process has already been waited for.
+ *
+ * @param pid PID of the process, or its negated PID to signal the process
+ *            group it leads (see PGROUP).
+ * @param sig Signal to send.
+ *
+ * @returns true if the signal was sent.
+ */
+bool ChildProcess::signal(pid_t pid,int sig) {
+    auto& reg = registry();
+    std::lock_guard<std::mutex> _(reg.mutex);
+    return reg.pids.count(pid<0 ? -pid : pid) && kill(pid,sig)==0;
+}
+
+/**
+ * Stop the process with SIGSTOP; if it was started with PGROUP, stop its
+ * whole process group. Safe against PID reuse (see `signal`).
+ *
+ * @returns true if the signal was sent.
+ */
+bool ChildProcess::pause() {
+    if (backend_) {
+        backend_->signal(pid_,SIGSTOP);
+        return true;
+    }
+    return signal(flags_ & PGROUP ? -pid_ : pid_,SIGSTOP);
+}
+
+/**
+ * Continue the process after `pause`.
+ *
+ * @returns true if the signal was sent.
+ */
+bool ChildProcess::resume() {
+    if (backend_) {
+        backend_->signal(pid_,SIGCONT);
+        return true;
+    }
+    return signal(flags_ & PGROUP ? -pid_ : pid_,SIGCONT);
+}
+
+/**
+ * Get the heartbeat counter of the process, i. e. how often it has called
+ * Heartbeat::beat() so far.
+ *
+ * @returns the counter, or nothing if the process wasn't started with
+ *          HEARTBEAT or has been waited for.
+ */
+std::optional<unsigned long long> ChildProcess::beats() const {
+    auto& hb = beat_table();
+    std::lock_guard<std::mutex> _(hb.mutex);
+    const auto p = pid_ ? hb.pids.find(pid_) : hb.pids.end();
+    if (p==hb.pids.end()) return std::nullopt;
+    return p->second->load(std::memory_order_relaxed);
+}
+
+/**
+ * Get the heartbeat counters of all running child processes that were
+ * started with HEARTBEAT.
+ */
+std::vector<std::pair<pid_t,unsigned long long>> ChildProcess::heartbeats() {
+    auto& hb = beat_table();
+    std::lock_guard<std::mutex> _(hb.mutex);
+    std::vector<std::pair<pid_t,unsigned long long>> ret;
+    ret.reserve(hb.pids.size());
+    for(const auto& p : hb.pids) {
+        ret.emplace_back(p.first,p.second->load(std::memory_order_relaxed));
+    }
+    return ret;
+}
+
+/**
+ * Get a file descriptor of a pipe connected to the process. The caller
+ * takes it over (the I/O functions close it when done); pipes that nobody
+ * took over are closed in the dtor.
  *
  * @param which specifies which file descriptor to return.
  *
  * @returns the requested file descriptor.
  *
- * @throws std::exception if no pipe to that fd was specified in the ctor.
+ * @throws std::exception if no pipe to that fd was specified in the ctor,
+ * or if it was taken over already.
  */
-int ChildProcess::pipefd(ChildProcess::Flags which) const {
+int ChildProcess::pipefd(ChildProcess::Flags which) {
 
     // Get the requested file descriptor array
     const auto fds =
@@ -216,12 +1182,14 @@ int ChildProcess::pipefd(ChildProcess::Flags which) const {
     }
 
     // Get the requested file descriptor from it
-    const auto ret = which==IN ? fds[1] : fds[0];
-    if (ret < 0) {
-        throw std::runtime_error("Pipe for mode " + std::to_string(which) + " not specified in ctor");
+    auto& fd = which==IN ? fds[1] : fds[0];
+    if (fd < 0) {
+        throw std::runtime_error("Pipe for mode " + std::to_string(which) + " not specified in ctor or already in use");
     }
 
-    // Return the file descriptor
+    // Hand the file descriptor over
+    const auto ret = fd;
+    fd = -1;
     return ret;
 }
 
@@ -230,6 +1198,13 @@ int ChildProcess::pipefd(ChildProcess::Flags which) const {
  * which does the actual work. When fct throws, the exception is forwarded
  * to the caller in the call to get() on the future returned by make_stdin.
  *
+ * When the process closes its standard input (e. g. by exiting, like `head`
+ * does when it has seen enough), the next write into the stream throws
+ * StdinClosed, which aborts fct so it doesn't produce data nobody reads.
+ * This is not an error: the future then returns normally. The stream has
+ * badbit set in its exception mask, so other write errors throw as well.
+ * SIGPIPE is blocked in the writer thread and never reaches the process.
+ *
  * Example:
  *
  *      ChildProcess chld(..., ChildProcess::IN);
@@ -246,11 +1221,18 @@ int ChildProcess::pipefd(ChildProcess::Flags which) const {
  * @returns handle to the writer thread.
  */
 std::future<void> ChildProcess::make_stdin(std::function<void(std::ostream&)> fct) {
-    return std::async(std::launch::async,[](int fd,std::function<void(std::ostream&)> f) {
-        boost::iostreams::file_descriptor_sink snk(fd,boost::iostreams::close_handle);
-        boost::iostreams::stream<boost::iostreams::file_descriptor_sink> os(snk);
-        f(os);
-    },pipefd(IN),fct);
+    return std::async(std::launch::async,[](int fd,pid_t pid,int flags,std::shared_ptr<IoStats> stats,std::function<void(std::ostream&)> f) {
+        const IoThread _;
+        const NoSigpipe nosigpipe;
+        pin_to_child(pid,flags);
+        boost::iostreams::stream<PipeSink> os(PipeSink(fd,stats));
+        os.exceptions(std::ios::badbit);
+        try {
+            f(os);
+            os.flush();
+        } catch(const StdinClosed&) {
+        }
+    },pipefd(IN),pid_,flags_,io_,fct);
 }
 
 /**
@@ -274,11 +1256,12 @@ std::future<void> ChildProcess::make_stdin(std::function<void(std::ostream&)> fc
  * @returns handle to the reader thread.
  */
 std::future<void> ChildProcess::get_stdout(std::function<void(std::istream&)> fct) {
-    return std::async(std::launch::async,[](int fd,std::function<void(std::istream&)> f) {
-        boost::iostreams::file_descriptor_source src(fd,boost::iostreams::close_handle);
-        boost::iostreams::stream<boost::iostreams::file_descriptor_source> is(src);
+    return std::async(std::launch::async,[](int fd,pid_t pid,int flags,std::shared_ptr<IoStats> stats,std::function<void(std::istream&)> f) {
+        const IoThread _;
+        pin_to_child(pid,flags);
+        boost::iostreams::stream<PipeSource> is(PipeSource(fd,stats));
         f(is);
-    },pipefd(OUT),fct);
+    },pipefd(OUT),pid_,flags_,io_,fct);
 }
 
 /**
@@ -302,9 +1285,221 @@ std::future<void> ChildProcess::get_stdout(std::function<void(std::istream&)> fc
  * @returns handle to the reader thread.
  */
 std::future<void> ChildProcess::get_stderr(std::function<void(std::istream&)> fct) {
-    return std::async(std::launch::async,[](int fd,std::function<void(std::istream&)> f) {
-        boost::iostreams::file_descriptor_source src(fd,boost::iostreams::close_handle);
-        boost::iostreams::stream<boost::iostreams::file_descriptor_source> is(src);
+    return std::async(std::launch::async,[](int fd,pid_t pid,int flags,std::shared_ptr<IoStats> stats,std::function<void(std::istream&)> f) {
+        const IoThread _;
+        pin_to_child(pid,flags);
+        boost::iostreams::stream<PipeSource> is(PipeSource(fd,stats));
         f(is);
-    },pipefd(ERR),fct);
+    },pipefd(ERR),pid_,flags_,io_,fct);
+}
+
+/**
+ * Read from the process' standard output without a stream. Creates a thread
+ * that reads from the pipe and calls fct with each chunk as it was read, as
+ * a view into the read buffer (valid only during the call). At the end of
+ * the output, fct is called once more with an empty chunk, so that stages
+ * that keep state between chunks can finish. When fct throws, the exception
+ * is forwarded to the caller in the call to get() on the future returned by
+ * read_stdout.
+ *
+ * Example:
+ *
+ *      ChildProcess chld(..., ChildProcess::OUT);
+ *
+ *      auto out = chld.read_stdout([](std::string_view chunk) {
+ *          output_of_the_process.append(chunk);
+ *      });
+ *
+ *      out.get();       // throws if fct throws
+ *      chld.join();
+ *
+ * @param fct Callable that receives the data.
+ *
+ * @returns handle to the reader thread.
+ */
+std::future<void> ChildProcess::read_stdout(Chunk fct) {
+    return read_chunks(OUT,fct);
+}
+
+/**
+ * Read from the process' standard error output without a stream (see
+ * read_stdout).
+ *
+ * @param fct Callable that receives the data.
+ *
+ * @returns handle to the reader thread.
+ */
+std::future<void> ChildProcess::read_stderr(Chunk fct) {
+    return read_chunks(ERR,fct);
+}
+
+/*
+ * Reader thread of read_stdout and read_stderr.
+ */
+std::future<void> ChildProcess::read_chunks(Flags which,Chunk fct) {
+    return std::async(std::launch::async,[](int fd,pid_t pid,int flags,std::shared_ptr<IoStats> stats,Chunk f) {
+        const IoThread _;
+        pin_to_child(pid,flags);
+        PipeSource src(fd,stats);
+        const auto buf = std::make_unique<char[]>(chunk_size);
+        try {
+            for(std::streamsize n;(n=src.read(buf.get(),chunk_size))>0;) {
+                f(std::string_view(buf.get(),n));
+            }
+            f(std::string_view());
+        } catch(...) {
+            src.close();
+            throw;
+        }
+        src.close();
+    },pipefd(which),pid_,flags_,io_,fct);
+}
+
+/**
+ * Move the process' standard output into a target without copying it
+ * through user space (e. g. a RotatingFile, see rotatingfile.hpp). Creates
+ * a thread that waits for data and lets the target splice it from the pipe,
+ * until the process closes its standard output. Both stdout and stderr may
+ * go into the same target. When the target throws, the exception is
+ * forwarded to the caller in the call to get() on the future returned.
+ *
+ * @param target Where the data goes.
+ *
+ * @returns handle to the thread.
+ */
+std::future<void> ChildProcess::splice_stdout(std::shared_ptr<SpliceTarget> target) {
+    return splice_to(OUT,std::move(target));
+}
+
+/**
+ * Move the process' standard error output into a target (see splice_stdout).
+ *
+ * @param target Where the data goes.
+ *
+ * @returns handle to the thread.
+ */
+std::future<void> ChildProcess::splice_stderr(std::shared_ptr<SpliceTarget> target) {
+    return splice_to(ERR,std::move(target));
+}
+
+/*
+ * Thread of splice_stdout and splice_stderr.
+ */
+std::future<void> ChildProcess::splice_to(Flags which,std::shared_ptr<SpliceTarget> target) {
+    return std::async(std::launch::async,[](int fd,pid_t pid,int flags,std::shared_ptr<IoStats> stats,std::shared_ptr<SpliceTarget> t) {
+        const IoThread _;
+        pin_to_child(pid,flags);
+        try {
+            for(;;) {
+                pollfd pfd = { fd, POLLIN, 0 };
+                if (poll(&pfd,1,t->idle_timeout())<0 && errno!=EINTR) {
+                    throw std::ios_base::failure("Error " + std::to_string(errno) + " waiting for the pipe");
+                }
+
+                const auto n = t->splice_from(fd);
+                if (n==0) break;
+                count(&IoStats::reads,*stats);
+                if (n>0) count(&IoStats::bytes_read,*stats,n);
+            }
+        } catch(...) {
+            close(fd);
+            throw;
+        }
+        close(fd);
+    },pipefd(which),pid_,flags_,io_,std::move(target));
+}
+
+/**
+ * Communicate with the process without I/O threads. Runs a poll loop in
+ * the calling thread that writes into the process' standard input and
+ * reads from its standard output and standard error, until all of them
+ * are done. Input is pulled from `in` only when the pipe can take more, one
+ * chunk at a time, so it can be produced lazily, however large it is; the
+ * view returned by `in` must stay valid until the next call. When the
+ * process closes its standard input, `in` isn't called any more. Output is
+ * passed to `out` and `err` chunk by chunk as with read_stdout.
+ *
+ * Example:
+ *
+ *      ChildProcess chld("/usr/bin/sort",{},ChildProcess::IN | ChildProcess::OUT);
+ *
+ *      chld.pump(
+ *          ChildProcess::from_range(std::vector<std::string>{ "b\n", "a\n" }),
+ *          [](std::string_view chunk) { sorted.append(chunk); }
+ *      );
+ *      chld.join();
+ *
+ * @param in Producer of the input, or empty to not write into the process.
+ * @param out Receives the standard output, or empty to not read it.
+ * @param err Receives the standard error output, or empty to not read it.
+ *
+ * @throws std::exception if one of the functions throws, or on I/O errors.
+ * The pipes served are closed in any case.
+ */
+void ChildProcess::pump(Producer in,Chunk out,Chunk err) {
+    struct Fds {
+        int fd[3];
+        ~Fds() { for(auto f : fd) if (f>=0) ::close(f); }
+        void close(int i) { ::close(fd[i]); fd[i] = -1; }
+    } fds{{ -1, -1, -1 }};
+    if (in)  fds.fd[0] = pipefd(IN);       // Owned one by one, in case a later pipefd throws
+    if (out) fds.fd[1] = pipefd(OUT);
+    if (err) fds.fd[2] = pipefd(ERR);
+    const Chunk* readers[3] = { nullptr, &out, &err };
+    const NoSigpipe _;
+
+    PipeSink sink(fds.fd[0],io_);
+    if (fds.fd[0]>=0) fcntl(fds.fd[0],F_SETFL,fcntl(fds.fd[0],F_GETFL) | O_NONBLOCK);
+    std::string_view pending;
+    const auto buf = std::make_unique<char[]>(chunk_size);
+
+    for(;;) {
+        pollfd pfd[3];
+        int which[3];
+        nfds_t n = 0;
+        for(auto i=0;i<3;++i) {
+            if (fds.fd[i]<0) continue;
+            pfd[n] = { fds.fd[i], short(i==0 ? POLLOUT : POLLIN), 0 };
+            which[n++] = i;
+        }
+        if (n==0) break;
+        if (poll(pfd,n,-1)<0) {
+            if (errno==EINTR) continue;
+            throw std::runtime_error("Error " + std::to_string(errno) + " polling the pipes");
+        }
+
+        for(nfds_t k=0;k<n;++k) {
+            const auto i = which[k];
+            if (!pfd[k].revents) continue;
+
+            if (i==0) {
+                // The process closed its stdin, or we can write
+                if (pfd[k].revents & (POLLERR | POLLHUP)) {
+                    fds.close(0);
+                    continue;
+                }
+                if (pending.empty()) {
+                    const auto chunk = in();
+                    if (!chunk) {
+                        fds.close(0);
+                        continue;
+                    }
+                    pending = *chunk;
+                }
+                try {
+                    pending.remove_prefix(sink.write_some(pending.data(),pending.size()));
+                } catch(const StdinClosed&) {
+                    fds.close(0);
+                }
+            } else {
+                const auto got = PipeSource(fds.fd[i],io_).read(buf.get(),chunk_size);
+                if (got<0) {
+                    (*readers[i])(std::string_view());
+                    fds.close(i);
+                } else {
+                    (*readers[i])(std::string_view(buf.get(),got));
+                }
+            }
+        }
+    }
 }
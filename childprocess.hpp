@@ -8,12 +8,54 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <future>
 #include <functional>
+#include <ios>
+#include <iterator>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <sys/types.h>
 
+/**
+ * Environment for child processes.
+ *
+ * An EnvBlock is immutable. It is materialized once into a contiguous envp
+ * array which is shared (reference-counted) by all copies of the object, so
+ * any number of child processes can be started with it without doing any
+ * per-process environment work. A default-constructed EnvBlock stands for
+ * the parent's environment as it is when the child process is started.
+ */
+class EnvBlock {
+public:
+    // Variable changes: value to set, or nullopt to remove the variable
+    using Overlay = std::vector<std::pair<std::string,std::optional<std::string>>>;
+
+    // Ctors
+    EnvBlock() = default;
+    EnvBlock(const EnvBlock& base,const Overlay& overlay);
+
+    // Snapshot of the current environment
+    static EnvBlock current();
+
+    // Access
+    char* const* envp() const;          ///< nullptr for the parent's environment
+    const char* get(const std::string& name) const;
+
+private:
+    struct Block;
+    std::shared_ptr<const Block> block_;
+
+    friend class ChildProcess;
+    EnvBlock with_heartbeat() const;
+};
+
 /**
  * Child process manager class.
  *
@@ -28,15 +70,108 @@ public:
     enum Flags {
         IN      = 1<<0,                 ///< Write into standard input
         OUT     = 1<<1,                 ///< Read from standard output
-        ERR     = 1<<2                  ///< Read from standard error output
+        ERR     = 1<<2,                 ///< Read from standard error output
+        PINCORE = 1<<3,                 ///< Run I/O threads on the child's CPUs
+        PINLLC  = 1<<4,                 ///< Run I/O threads on CPUs sharing the child's last-level cache
+        DELAYS  = 1<<5,                 ///< Collect delay accounting (taskstats) in join
+        HEARTBEAT = 1<<6,               ///< Give the child a heartbeat counter (see heartbeat.hpp)
+        PGROUP  = 1<<7                  ///< Run the child in a new process group
     };
 
+    // Delay accounting of a terminated process (see DELAYS)
+    struct Delays {
+        bool valid = false;             ///< Whether taskstats could be read
+        std::chrono::nanoseconds cpu{0};    ///< Waiting for a CPU while runnable
+        std::chrono::nanoseconds blkio{0};  ///< Waiting for synchronous block I/O
+        std::chrono::nanoseconds swapin{0}; ///< Waiting for pages to be swapped in
+        unsigned long long cpu_count = 0;   ///< Number of CPU delays
+        unsigned long long blkio_count = 0; ///< Number of block I/O delays
+        unsigned long long swapin_count = 0;///< Number of swap-in delays
+    };
+
+    // Resource usage of a terminated process, from wait4 in join
+    struct Usage {
+        bool valid = false;             ///< Whether the process was reaped by join
+        std::chrono::microseconds user{0};      ///< User CPU time
+        std::chrono::microseconds system{0};    ///< System CPU time
+        unsigned long long max_rss = 0;         ///< Peak resident set size (bytes)
+    };
+
+    // I/O statistics of the pipes (updated while piping)
+    struct IoStats {
+        std::atomic<unsigned long long> bytes_written{0};   ///< Bytes written into stdin
+        std::atomic<unsigned long long> bytes_read{0};      ///< Bytes read from stdout and stderr
+        std::atomic<unsigned long long> writes{0};          ///< write syscalls
+        std::atomic<unsigned long long> reads{0};           ///< read syscalls
+        std::atomic<unsigned long long> partial_writes{0};  ///< Writes that wrote less than requested
+        std::atomic<unsigned long long> eagains{0};         ///< EAGAIN results (non-blocking pipes)
+        std::atomic<unsigned long long> max_fill{0};        ///< Most bytes seen waiting in a pipe
+        std::atomic<unsigned long long> epipes{0};          ///< Writes that found stdin closed by the process
+    };
+
+    // Latency histogram with fixed buckets
+    struct Histogram {
+        static constexpr double bounds[] = {        ///< Upper bucket bounds (seconds)
+            1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1, 2.5, 5
+        };
+        static constexpr size_t buckets = sizeof(bounds)/sizeof(bounds[0]);
+        std::atomic<unsigned long long> counts[buckets+1] = {};   ///< Per bucket (not cumulative), last is +Inf
+        std::atomic<unsigned long long> sum_ns{0};                ///< Sum of all values
+
+        void add(std::chrono::nanoseconds);
+    };
+
+    // Statistics of all child processes together
+    struct Stats {
+        std::atomic<unsigned long long> spawns{0};  ///< Processes started
+        Histogram spawn_latency;                    ///< Time spent in the ctor
+        Histogram reap_latency;                     ///< Time from SIGTERM until reaped, in the dtor only (join can't tell when the process terminated)
+        std::atomic<unsigned> io_threads{0};        ///< Running make_stdin/get_stdout/get_stderr threads
+    };
+
+    /**
+     * Process creation and control. By default, ChildProcess uses fork,
+     * exec, kill, and waitpid directly. Another backend (e. g. FakeBackend
+     * for tests) may be installed with `install`; it is then used for all
+     * processes started afterwards.
+     */
+    class Backend {
+    public:
+        virtual ~Backend() = default;
+
+        // Start a process with the given stdin/stdout/stderr fds (-1: inherit; the
+        // backend must dup what it keeps). Returns an ID other than 0. May throw.
+        virtual pid_t spawn(
+            const std::string& exe,
+            const std::vector<std::string>& args,
+            int flags,
+            const std::function<void()>& init,
+            const EnvBlock& env,
+            const int fds[3]
+        ) = 0;
+
+        // Wait for termination and return the wait status; if `nohang`,
+        // return nullopt if the process is still running
+        virtual std::optional<int> wait(pid_t pid,bool nohang) = 0;
+
+        // Send a signal
+        virtual void signal(pid_t pid,int sig) = 0;
+    };
+    static std::shared_ptr<Backend> install(std::shared_ptr<Backend> backend);
+
     // Ctor/dtor
     explicit ChildProcess(
         const std::string& exe,
         std::vector<std::string> const& args={},
         int flags=0,
-        std::function<void()> init=[](){}
+        std::function<void()> init=[](){},
+        EnvBlock env={}
+    );
+    ChildProcess(
+        std::shared_ptr<Backend> backend,
+        const std::string& exe,
+        std::vector<std::string> const& args={},
+        int flags=0
     );
     ChildProcess(ChildProcess &&) noexcept;
     ~ChildProcess();
@@ -48,17 +183,108 @@ public:
 
     // Wait for process to terminate
     int join();
+    const Delays& delays() const { return delays_; }
+    const Usage& usage() const { return usage_; }
+
+    // I/O statistics of this process and of all processes together
+    const IoStats& io_stats() const { return *io_; }
+    static const IoStats& total_io_stats();
+    static const Stats& stats();
+
+    // Running child processes
+    pid_t pid() const { return pid_; }
+    static std::vector<pid_t> live();
+    static bool signal(pid_t pid,int sig);
+
+    // Stop and continue the process (with PGROUP: and its descendants)
+    bool pause();
+    bool resume();
+
+    // Heartbeat counters (see HEARTBEAT)
+    std::optional<unsigned long long> beats() const;
+    static std::vector<std::pair<pid_t,unsigned long long>> heartbeats();
+
+    // Thrown into make_stdin's function when the process closes its stdin
+    struct StdinClosed : std::ios_base::failure {
+        StdinClosed() : std::ios_base::failure("Standard input closed by the process") {}
+    };
 
     // Piping
     std::future<void> make_stdin(std::function<void(std::ostream&)>);
     std::future<void> get_stdout(std::function<void(std::istream&)>);
     std::future<void> get_stderr(std::function<void(std::istream&)>);
 
+    // Piping, chunk by chunk as read from the pipe
+    using Chunk = std::function<void(std::string_view)>;
+    std::future<void> read_stdout(Chunk);
+    std::future<void> read_stderr(Chunk);
+
+    // Piping without copying: data is spliced from the pipe into the target
+    class SpliceTarget {
+    public:
+        virtual ~SpliceTarget() = default;
+
+        // Move what's waiting in the pipe into the target, without blocking
+        // on the pipe. Returns the number of bytes moved, 0 at EOF, or -1 if
+        // the pipe is empty. May throw.
+        virtual ssize_t splice_from(int pipe) = 0;
+
+        // Milliseconds until splice_from should be called even if no data
+        // arrives (e. g. for time-based rotation); -1: only for data
+        virtual int idle_timeout() = 0;
+    };
+    std::future<void> splice_stdout(std::shared_ptr<SpliceTarget>);
+    std::future<void> splice_stderr(std::shared_ptr<SpliceTarget>);
+
+    // Piping without I/O threads: chunks for stdin are pulled from the
+    // producer when the pipe is writable (nullopt: end of input)
+    using Producer = std::function<std::optional<std::string_view>()>;
+    void pump(Producer in,Chunk out={},Chunk err={});
+    template<typename Range> static Producer from_range(Range range);
+
 private:
     pid_t pid_ = 0;                     // PID of the process we started (0=none)
+    int flags_ = 0;                     // Flags passed to the ctor
     int pipein_[2]  = { -1, -1 };       // stdin pipe file descriptors
     int pipeout_[2] = { -1, -1 };       // stdout pipe file descriptors
     int pipeerr_[2] = { -1, -1 };       // stderr pipe file descriptors
+    Delays delays_;                     // Delay accounting, collected in join
+    Usage usage_;                       // Resource usage, collected in join
+    std::shared_ptr<IoStats> io_;       // I/O statistics, shared with the I/O threads
+    std::shared_ptr<Backend> backend_;  // Backend that started the process (nullptr=native)
 
-    int pipefd(Flags which) const;
+    void spawn(const std::string& exe,const std::vector<std::string>& args,const std::function<void()>& init,const EnvBlock& env);
+    int pipefd(Flags which);
+    std::future<void> read_chunks(Flags which,Chunk fct);
+    std::future<void> splice_to(Flags which,std::shared_ptr<SpliceTarget> target);
 };
+
+/**
+ * Make a producer for ChildProcess::pump that yields the elements of a
+ * range (e. g. a container of strings) one by one. The range is moved into
+ * the producer; elements are converted to string_view. Elements returned
+ * by value (not by reference) by the iterator are kept until the next one
+ * is pulled.
+ */
+template<typename Range>
+ChildProcess::Producer ChildProcess::from_range(Range range) {
+    using Iterator = decltype(std::begin(range));
+    using Element = decltype(*std::declval<Iterator>());
+    struct State {
+        Range range;
+        std::optional<Iterator> it;
+        std::optional<std::decay_t<Element>> value;   // Element returned by value
+    };
+    auto st = std::make_shared<State>(State{ std::move(range), std::nullopt, std::nullopt });
+
+    return [st]() -> std::optional<std::string_view> {
+        if (st->it) ++*st->it; else st->it = std::begin(st->range);
+        if (*st->it==std::end(st->range)) return std::nullopt;
+        if constexpr (std::is_reference_v<Element>) {
+            return std::string_view(**st->it);
+        } else {
+            st->value = **st->it;
+            return std::string_view(*st->value);
+        }
+    };
+}
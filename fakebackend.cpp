@@ -0,0 +1,235 @@
+/**
+ * @brief In-process fake child processes implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "fakebackend.hpp"
+
+namespace {
+
+// How often blocked fake processes check for signals
+const int poll_ms = 10;
+
+/*
+ * Wait until a non-blocking fd is ready or `stop` says to give up.
+ */
+template<typename Stop>
+bool ready(int fd,short events,Stop stop) {
+    while(!stop()) {
+        pollfd pfd = { fd, events, 0 };
+        if (poll(&pfd,1,poll_ms)>0) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+/**
+ * Terminate all fake processes that are still running.
+ */
+FakeBackend::~FakeBackend() {
+    std::map<pid_t,std::shared_ptr<Proc>> procs;
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        procs.swap(procs_);
+    }
+    for(auto& p : procs) {
+        {
+            std::lock_guard<std::mutex> _(p.second->mutex);
+            p.second->killed = SIGKILL;
+        }
+        p.second->cv.notify_all();
+        p.second->thread.join();
+    }
+}
+
+/**
+ * Define what happens when a program is started.
+ *
+ * @param exe The program, as passed to the ChildProcess ctor.
+ * @param script What the fake process does. Scripts for the same program
+ *               are used in the order given; the last one is used again
+ *               for all further starts.
+ */
+void FakeBackend::expect(const std::string& exe,Script script) {
+    std::lock_guard<std::mutex> _(mutex_);
+    scripts_[exe].push_back(std::move(script));
+}
+
+/**
+ * Get the programs started so far, in order, with their arguments.
+ */
+std::vector<std::string> FakeBackend::started() const {
+    std::lock_guard<std::mutex> _(mutex_);
+    return started_;
+}
+
+/**
+ * Get the problems found, e. g. unexpected standard input.
+ */
+std::vector<std::string> FakeBackend::failures() const {
+    std::lock_guard<std::mutex> _(mutex_);
+    return failures_;
+}
+
+/**
+ * Start a fake process.
+ *
+ * @throws std::exception if there is no script for the program.
+ */
+pid_t FakeBackend::spawn(
+    const std::string& exe,
+    const std::vector<std::string>& args,
+    int,
+    const std::function<void()>&,
+    const EnvBlock&,
+    const int fds[3]
+) {
+    auto p = std::make_shared<Proc>();
+    pid_t pid;
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        auto s = scripts_.find(exe);
+        if (s==scripts_.end()) {
+            throw std::runtime_error("FakeBackend: Unexpected program " + exe);
+        }
+        p->script = s->second.front();
+        if (s->second.size()>1) s->second.pop_front();
+
+        auto cmd = exe;
+        for(const auto& a : args) cmd += " " + a;
+        started_.push_back(cmd);
+
+        pid = next_--;
+        procs_[pid] = p;
+    }
+
+    p->exe = exe;
+    for(auto i=0;i<3;++i) {
+        if (fds[i]>=0) {
+            p->fds[i] = fcntl(fds[i],F_DUPFD_CLOEXEC,0);
+            fcntl(p->fds[i],F_SETFL,O_NONBLOCK);
+        }
+    }
+    p->thread = std::thread([this,p](){ run(*p); });
+    return pid;
+}
+
+/**
+ * Wait for a fake process to exit.
+ */
+std::optional<int> FakeBackend::wait(pid_t pid,bool nohang) {
+    std::shared_ptr<Proc> p;
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        const auto it = procs_.find(pid);
+        if (it==procs_.end()) return -1;
+        p = it->second;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(p->mutex);
+        if (nohang && !p->done) return std::nullopt;
+        p->cv.wait(lock,[&p](){ return p->done; });
+    }
+
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        if (!procs_.erase(pid)) return p->status;   // Someone else reaped it
+    }
+    p->thread.join();
+    return p->status;
+}
+
+/**
+ * Send a signal to a fake process. SIGTERM (unless ignored by the script),
+ * SIGKILL, SIGINT, and SIGHUP terminate it; other signals are ignored.
+ */
+void FakeBackend::signal(pid_t pid,int sig) {
+    std::shared_ptr<Proc> p;
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        const auto it = procs_.find(pid);
+        if (it==procs_.end()) return;
+        p = it->second;
+    }
+
+    if (sig==SIGTERM && p->script.ignore_sigterm) return;
+    if (sig!=SIGTERM && sig!=SIGKILL && sig!=SIGINT && sig!=SIGHUP) return;
+    {
+        std::lock_guard<std::mutex> _(p->mutex);
+        if (!p->killed) p->killed = sig;
+    }
+    p->cv.notify_all();
+}
+
+/*
+ * Play the script of a fake process.
+ */
+void FakeBackend::run(Proc& p) {
+    const auto killed = [&p](){
+        std::lock_guard<std::mutex> _(p.mutex);
+        return p.killed!=0;
+    };
+
+    // Read stdin in parallel, so neither side can block the other
+    std::string in;
+    std::thread reader;
+    if (p.fds[0]>=0) {
+        reader = std::thread([&](){
+            char buf[4096];
+            while(ready(p.fds[0],POLLIN,killed)) {
+                const auto n = read(p.fds[0],buf,sizeof(buf));
+                if (n==0 || (n<0 && errno!=EAGAIN && errno!=EINTR)) break;
+                if (n>0) in.append(buf,n);
+            }
+        });
+    }
+
+    // Write the output
+    const auto output = [&](int fd,const std::string& data) {
+        if (fd<0) return;
+        size_t done = 0;
+        while(done<data.size() && ready(fd,POLLOUT,killed)) {
+            const auto n = write(fd,data.data()+done,data.size()-done);
+            if (n<0 && errno!=EAGAIN && errno!=EINTR) break;
+            if (n>0) done += n;
+        }
+    };
+    output(p.fds[1],p.script.out);
+    output(p.fds[2],p.script.err);
+
+    // EOF for the readers
+    for(auto i : { 1, 2 }) {
+        if (p.fds[i]>=0) close(p.fds[i]);
+    }
+    if (reader.joinable()) reader.join();
+    if (p.fds[0]>=0) close(p.fds[0]);
+
+    if (p.script.expect_in && !killed() && in!=*p.script.expect_in) {
+        fail(p.exe + ": Expected stdin \"" + *p.script.expect_in + "\", got \"" + in + "\"");
+    }
+
+    // Keep running for a while, then exit
+    std::unique_lock<std::mutex> lock(p.mutex);
+    p.cv.wait_for(lock,p.script.delay,[&p](){ return p.killed!=0; });
+    p.status = p.killed ? p.killed : (p.script.exit_code & 0xff) << 8;
+    p.done = true;
+    p.cv.notify_all();
+}
+
+/*
+ * Record a problem.
+ */
+void FakeBackend::fail(const std::string& what) {
+    std::lock_guard<std::mutex> _(mutex_);
+    failures_.push_back(what);
+}
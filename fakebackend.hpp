@@ -0,0 +1,100 @@
+/**
+ * @brief In-process fake child processes header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "childprocess.hpp"
+
+/**
+ * ChildProcess backend that doesn't start any processes.
+ *
+ * For unit tests of code that uses ChildProcess. Instead of running a
+ * program, a thread in the calling process plays a script: it writes the
+ * given stdout and stderr data into the pipes, reads stdin and compares it
+ * to what's expected, waits for a while, and "exits" with the given code.
+ * Signals sent by the ChildProcess dtor terminate the fake process. The
+ * init function passed to the ChildProcess ctor is not called.
+ *
+ *      auto fake = std::make_shared<FakeBackend>();
+ *      fake->expect("/bin/grep",{ "match\n", "", 0 });
+ *      const auto previous = ChildProcess::install(fake);
+ *      ... code under test ...
+ *      ChildProcess::install(previous);
+ *      BOOST_TEST(fake->failures().empty());
+ */
+class FakeBackend : public ChildProcess::Backend {
+public:
+    // What a fake process does
+    struct Script {
+        std::string out;                        ///< Written to stdout
+        std::string err;                        ///< Written to stderr
+        int exit_code = 0;                      ///< Exit status
+        std::chrono::milliseconds delay{0};     ///< Running time after the output was written
+        std::optional<std::string> expect_in;   ///< Expected standard input (checked at EOF)
+        bool ignore_sigterm = false;            ///< Keep running on SIGTERM
+    };
+
+    FakeBackend() = default;
+    ~FakeBackend();
+
+    // Define what happens when `exe` is started; the last script given
+    // for a program is used again for all further starts
+    void expect(const std::string& exe,Script script);
+
+    // Programs started so far ("exe arg1 arg2 ...")
+    std::vector<std::string> started() const;
+
+    // Problems found (unexpected stdin)
+    std::vector<std::string> failures() const;
+
+    // Backend interface
+    pid_t spawn(
+        const std::string& exe,
+        const std::vector<std::string>& args,
+        int flags,
+        const std::function<void()>& init,
+        const EnvBlock& env,
+        const int fds[3]
+    ) override;
+    std::optional<int> wait(pid_t pid,bool nohang) override;
+    void signal(pid_t pid,int sig) override;
+
+private:
+    // A running fake process
+    struct Proc {
+        Script script;
+        std::string exe;
+        int fds[3] = { -1, -1, -1 };
+        std::mutex mutex;
+        std::condition_variable cv;
+        int killed = 0;                         // Terminating signal received
+        bool done = false;                      // Exited
+        int status = -1;                        // Wait status
+        std::thread thread;
+    };
+
+    mutable std::mutex mutex_;
+    std::map<std::string,std::deque<Script>> scripts_;
+    std::map<pid_t,std::shared_ptr<Proc>> procs_;
+    pid_t next_ = -1;                           // IDs are negative so they're never real PIDs
+    std::vector<std::string> started_;
+    std::vector<std::string> failures_;
+
+    void run(Proc& p);
+    void fail(const std::string& what);
+};
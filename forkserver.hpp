@@ -0,0 +1,164 @@
+/**
+ * @brief Template worker fork server header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <poll.h>
+#include <signal.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/**
+ * Fork server, for use in the program of a template worker (see
+ * TemplateWorker in templateworker.hpp).
+ *
+ * A program that takes long to initialize (e. g. loading a model or an
+ * index) calls `ForkServer::serve()` when it's ready. If it was started by
+ * TemplateWorker, it doesn't return, but waits for requests from the parent
+ * and forks a copy of itself for each; serve() returns true in these
+ * copies, with the copy's own stdin, stdout, and stderr. Otherwise, it
+ * returns false right away, so the program works normally when run
+ * directly. Header-only, so worker programs don't need to link anything.
+ *
+ *      int main() {
+ *          load_model();
+ *          ForkServer::serve();
+ *          for(std::string line;std::getline(std::cin,line);) ...
+ *      }
+ *
+ * The environment variable contains the fd of a SOCK_SEQPACKET socket to
+ * the parent. The parent sends Request messages, with the new copy's
+ * stdin/stdout/stderr as SCM_RIGHTS for FORK; the server answers each
+ * FORK with FORKED or FAILED, and sends EXITED when a copy has terminated.
+ * The server exits when the parent closes the socket.
+ */
+struct ForkServer {
+    static constexpr const char* env = "CHILDPROCESS_TEMPLATE";
+
+    // Message from the parent
+    struct Request {
+        enum Type : uint32_t { FORK = 1, SIGNAL = 2 } type;
+        uint32_t fds;           // FORK: which of stdin/stdout/stderr (bits 0..2) are sent
+        int32_t pid;            // SIGNAL: copy to signal
+        int32_t sig;            // SIGNAL: signal number
+    };
+
+    // Message to the parent
+    struct Reply {
+        enum Type : uint32_t { FORKED = 1, FAILED = 2, EXITED = 3 } type;
+        int32_t pid;            // FORKED, EXITED: the copy
+        int32_t value;          // FAILED: errno; EXITED: wait status
+    };
+
+    static bool serve() {
+        const auto var = getenv(env);
+        if (!var) return false;
+        const int sock = atoi(var);
+        unsetenv(env);
+
+        // Learn about terminated copies through a signalfd
+        sigset_t chld, old;
+        sigemptyset(&chld);
+        sigaddset(&chld,SIGCHLD);
+        sigprocmask(SIG_BLOCK,&chld,&old);
+        const auto sfd = signalfd(-1,&chld,SFD_CLOEXEC | SFD_NONBLOCK);
+
+        std::set<pid_t> copies;
+        for(;;) {
+            pollfd pfd[2] = { { sock, POLLIN, 0 }, { sfd, POLLIN, 0 } };
+            if (poll(pfd,2,-1)<0) {
+                if (errno==EINTR) continue;
+                _exit(EXIT_FAILURE);
+            }
+
+            // Report terminated copies
+            if (pfd[1].revents) {
+                signalfd_siginfo info;
+                while(read(sfd,&info,sizeof(info))>0) {}
+                int status;
+                for(pid_t pid;(pid=waitpid(-1,&status,WNOHANG))>0;) {
+                    copies.erase(pid);
+                    send(sock,Reply{ Reply::EXITED, pid, status });
+                }
+            }
+            if (!pfd[0].revents) continue;
+
+            // Handle a request
+            Request req;
+            int fds[3];
+            const auto n = receive(sock,req,fds);
+            if (n==0) _exit(EXIT_SUCCESS);      // Parent has gone
+            if (n<0) continue;
+
+            if (req.type==Request::SIGNAL) {
+                if (copies.count(req.pid)) kill(req.pid,req.sig);
+                continue;
+            }
+
+            const auto pid = fork();
+            if (pid==0) {
+                // The copy: take over the new fds, and go to work
+                close(sock);
+                close(sfd);
+                sigprocmask(SIG_SETMASK,&old,nullptr);
+                for(auto i=0;i<3;++i) {
+                    if (fds[i]>=0) {
+                        dup2(fds[i],i);
+                        close(fds[i]);
+                    }
+                }
+                return true;
+            }
+            for(auto fd : fds) if (fd>=0) close(fd);
+            if (pid>0) copies.insert(pid);
+            send(sock,pid>0 ? Reply{ Reply::FORKED, pid, 0 } : Reply{ Reply::FAILED, 0, errno });
+        }
+    }
+
+private:
+    // Send a reply
+    static void send(int sock,const Reply& reply) {
+        while(::send(sock,&reply,sizeof(reply),MSG_NOSIGNAL)<0 && errno==EINTR) {}
+    }
+
+    // Receive a request with its fds (-1: not sent); returns 0 at EOF
+    static ssize_t receive(int sock,Request& req,int fds[3]) {
+        char control[CMSG_SPACE(3*sizeof(int))];
+        iovec iov = { &req, sizeof(req) };
+        msghdr msg = {};
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        const auto n = recvmsg(sock,&msg,MSG_CMSG_CLOEXEC);
+        fds[0] = fds[1] = fds[2] = -1;
+        if (n<=0) return n;
+
+        const auto cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg && cmsg->cmsg_level==SOL_SOCKET && cmsg->cmsg_type==SCM_RIGHTS) {
+            auto data = reinterpret_cast<const unsigned char*>(CMSG_DATA(cmsg));
+            auto count = (cmsg->cmsg_len-CMSG_LEN(0))/sizeof(int);
+            for(auto i=0;i<3 && count>0;++i) {
+                if (req.fds & (1u<<i)) {
+                    memcpy(&fds[i],data,sizeof(int));
+                    data += sizeof(int);
+                    --count;
+                }
+            }
+        }
+        return n;
+    }
+};
@@ -0,0 +1,54 @@
+/**
+ * @brief Child process heartbeat header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * Heartbeat of a child process, for use in the child's program.
+ *
+ * A process started with ChildProcess::HEARTBEAT finds a shared memory
+ * counter in its environment; calling `Heartbeat::beat()` regularly (e. g.
+ * once per unit of work) tells the parent that it's making progress, at the
+ * cost of one atomic add. ProcessMonitor::on_stall reports processes that
+ * haven't beaten for a while. In processes started without HEARTBEAT,
+ * beat() does nothing. Header-only, so child programs don't need to link
+ * anything.
+ *
+ * The environment variable contains the number of the file descriptor
+ * (always Heartbeat::fd) of a memfd whose first 64 bits are the counter.
+ * Every process has a memfd of its own, so it can't touch other processes'
+ * counters.
+ */
+struct Heartbeat {
+    static constexpr const char* env = "CHILDPROCESS_HEARTBEAT";
+    static constexpr int fd = 1000;
+
+    static void beat() {
+        static const auto counter = map();
+        if (counter) __atomic_add_fetch(counter,1,__ATOMIC_RELAXED);
+    }
+
+private:
+    // Map the counter
+    static uint64_t* map() {
+        const auto var = getenv(env);
+        if (!var) return nullptr;
+        char* end;
+        const auto fd = strtol(var,&end,10);
+        if (*end) return nullptr;
+
+        const auto p = mmap(nullptr,sysconf(_SC_PAGESIZE),PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+        if (p==MAP_FAILED) return nullptr;
+        return static_cast<uint64_t*>(p);
+    }
+};
@@ -0,0 +1,121 @@
+/**
+ * @brief Allocation and syscall counting for the performance budget tests
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ *
+ * Replaces malloc & co. and the libc syscall wrappers used by the library
+ * with versions that count their calls and then call the real functions.
+ * Counting is per thread and only while enabled with count_begin. This
+ * file intentionally includes no libc headers that declare the replaced
+ * functions.
+ */
+
+#include <cstdarg>
+#include <cstddef>
+#include <dlfcn.h>
+#include <sys/types.h>
+
+struct stat;
+struct pollfd;
+struct sockaddr;
+struct timespec;
+
+extern "C" void* __libc_malloc(size_t);
+extern "C" void* __libc_calloc(size_t,size_t);
+extern "C" void* __libc_realloc(void*,size_t);
+extern "C" void __libc_free(void*);
+
+namespace {
+thread_local bool counting = false;
+thread_local unsigned long allocs = 0;
+thread_local unsigned long syscalls = 0;
+}
+
+/*
+ * Start counting in the calling thread.
+ */
+void count_begin() {
+    allocs = 0;
+    syscalls = 0;
+    counting = true;
+}
+
+/*
+ * Stop counting in the calling thread and get the counts.
+ */
+void count_end(unsigned long& nallocs,unsigned long& nsyscalls) {
+    counting = false;
+    nallocs = allocs;
+    nsyscalls = syscalls;
+}
+
+extern "C" void* malloc(size_t size) {
+    if (counting) ++allocs;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n,size_t size) {
+    if (counting) ++allocs;
+    return __libc_calloc(n,size);
+}
+
+extern "C" void* realloc(void* p,size_t size) {
+    if (counting) ++allocs;
+    return __libc_realloc(p,size);
+}
+
+extern "C" void free(void* p) {
+    __libc_free(p);
+}
+
+// Replace a syscall wrapper
+#define COUNTED(ret,name,params,args)                                                           \
+    extern "C" ret name params {                                                                \
+        static const auto real = reinterpret_cast<ret(*)params>(dlsym(RTLD_NEXT,#name));        \
+        if (counting) ++syscalls;                                                               \
+        return real args;                                                                       \
+    }
+
+COUNTED(int,    stat,             (const char* p,struct stat* b),              (p,b))
+COUNTED(int,    pipe2,            (int* fds,int flags),                        (fds,flags))
+COUNTED(pid_t,  fork,             (),                                          ())
+COUNTED(int,    close,            (int fd),                                    (fd))
+COUNTED(ssize_t,read,             (int fd,void* b,size_t n),                   (fd,b,n))
+COUNTED(ssize_t,write,            (int fd,const void* b,size_t n),             (fd,b,n))
+COUNTED(int,    waitid,           (int type,id_t id,void* info,int options),   (type,id,info,options))
+COUNTED(pid_t,  waitpid,          (pid_t pid,int* status,int options),         (pid,status,options))
+COUNTED(pid_t,  wait4,            (pid_t pid,int* status,int options,struct rusage* r),(pid,status,options,r))
+COUNTED(int,    kill,             (pid_t pid,int sig),                         (pid,sig))
+COUNTED(int,    dup2,             (int from,int to),                           (from,to))
+COUNTED(int,    sched_getaffinity,(pid_t pid,size_t size,void* set),           (pid,size,set))
+COUNTED(int,    poll,             (struct pollfd* fds,unsigned long n,int t),  (fds,n,t))
+COUNTED(int,    socket,           (int domain,int type,int protocol),          (domain,type,protocol))
+COUNTED(ssize_t,sendto,           (int fd,const void* b,size_t n,int flags,const struct sockaddr* a,unsigned l),(fd,b,n,flags,a,l))
+COUNTED(ssize_t,recv,             (int fd,void* b,size_t n,int flags),         (fd,b,n,flags))
+COUNTED(int,    setpgid,          (pid_t pid,pid_t pgid),                      (pid,pgid))
+COUNTED(int,    memfd_create,     (const char* name,unsigned flags),           (name,flags))
+COUNTED(int,    ftruncate,        (int fd,off_t size),                         (fd,size))
+COUNTED(void*,  mmap,             (void* a,size_t n,int prot,int flags,int fd,off_t o),(a,n,prot,flags,fd,o))
+COUNTED(int,    munmap,           (void* a,size_t n),                          (a,n))
+COUNTED(int,    nanosleep,        (const struct timespec* t,struct timespec* r),(t,r))
+COUNTED(int,    sigtimedwait,     (const void* set,void* info,const struct timespec* t),(set,info,t))
+COUNTED(int,    pthread_sigmask,  (int how,const void* set,void* old),         (how,set,old))
+COUNTED(int,    pthread_setaffinity_np,(unsigned long t,size_t size,const void* set),(t,size,set))
+COUNTED(int,    pthread_create,   (void* t,const void* attr,void*(*f)(void*),void* arg),(t,attr,f,arg))
+
+// Replace a syscall wrapper with an optional third argument
+#define COUNTED_VARARGS(name,type)                                                              \
+    extern "C" int name(int fd,type request,...) {                                              \
+        static const auto real = reinterpret_cast<int(*)(int,type,void*)>(dlsym(RTLD_NEXT,#name)); \
+        va_list ap;                                                                             \
+        va_start(ap,request);                                                                   \
+        const auto arg = va_arg(ap,void*);                                                      \
+        va_end(ap);                                                                             \
+        if (counting) ++syscalls;                                                               \
+        return real(fd,request,arg);                                                            \
+    }
+
+COUNTED_VARARGS(fcntl,int)
+COUNTED_VARARGS(ioctl,unsigned long)
@@ -0,0 +1,230 @@
+/**
+ * @brief Child process group pause/resume implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "jobgroup.hpp"
+
+namespace {
+
+// How long to wait for processes to stop
+const auto stop_timeout = std::chrono::seconds(1);
+
+/*
+ * Write a string into a file that's already there (e. g. in /sys).
+ */
+bool put(const std::string& path,const std::string& value) {
+    const auto fd = open(path.c_str(),O_WRONLY | O_CLOEXEC);
+    if (fd<0) return false;
+    const auto ok = write(fd,value.data(),value.size())==ssize_t(value.size());
+    close(fd);
+    return ok;
+}
+
+/*
+ * Find out where the cgroup v2 hierarchy is mounted and which cgroup we're
+ * in, so that our cgroup directory is mount + path.
+ */
+std::string own_cgroup() {
+    std::string mount;
+    std::ifstream mounts("/proc/self/mountinfo");
+    for(std::string line;std::getline(mounts,line);) {
+        const auto sep = line.find(" - ");
+        if (sep==std::string::npos || line.compare(sep+3,8,"cgroup2 ")!=0) continue;
+        std::istringstream fields(line);
+        std::string field;
+        for(auto i=0;i<5;++i) fields >> field;
+        mount = field;
+        break;
+    }
+    if (mount.empty()) return {};
+
+    std::ifstream cgroups("/proc/self/cgroup");
+    for(std::string line;std::getline(cgroups,line);) {
+        if (line.compare(0,3,"0::")==0) return mount + (line.size()>4 ? line.substr(3) : "");
+    }
+    return {};
+}
+
+/*
+ * Check if a process is stopped (or gone).
+ */
+bool stopped(pid_t pid) {
+    char path[32], buf[512];
+    snprintf(path,sizeof(path),"/proc/%d/stat",pid);
+    const auto fd = open(path,O_RDONLY | O_CLOEXEC);
+    if (fd<0) return true;
+    const auto n = read(fd,buf,sizeof(buf)-1);
+    close(fd);
+    if (n<=0) return true;
+    buf[n] = 0;
+    const auto paren = strrchr(buf,')');
+    return !paren || paren[2]=='T' || paren[2]=='t' || paren[2]=='Z' || paren[2]=='X';
+}
+
+} // namespace
+
+/**
+ * Make an empty group.
+ *
+ * @param mode How to pause the processes. With AUTO, a cgroup is used if
+ *             one can be created.
+ *
+ * @throws std::exception if mode is CGROUP and no cgroup can be created.
+ */
+JobGroup::JobGroup(Mode mode) : mode_(mode) {
+    if (mode_==SIGNALS) return;
+    if (make_cgroup()) {
+        mode_ = CGROUP;
+    } else if (mode_==CGROUP) {
+        throw std::runtime_error("Error " + std::to_string(errno) + " creating a cgroup");
+    } else {
+        mode_ = SIGNALS;
+    }
+}
+
+/**
+ * Resume the processes, and remove the cgroup. Processes that are still
+ * running are moved back to our own cgroup.
+ */
+JobGroup::~JobGroup() {
+    if (paused_) resume();
+    if (mode_!=CGROUP) return;
+
+    std::ifstream procs(path_ + "/cgroup.procs");
+    for(std::string pid;std::getline(procs,pid);) {
+        put(parent_ + "/cgroup.procs",pid);
+    }
+    rmdir(path_.c_str());
+}
+
+/**
+ * Start a process in the group. Takes the same parameters as the
+ * ChildProcess ctor. The process joins the group before `init` is run, so
+ * all its descendants are in the group as well.
+ *
+ * @returns the process.
+ *
+ * @throws std::exception if an error occurs.
+ */
+ChildProcess JobGroup::start(
+    const std::string& exe,
+    const std::vector<std::string>& args,
+    int flags,
+    std::function<void()> init,
+    EnvBlock env
+) {
+    if (mode_==CGROUP) {
+        const auto procs = path_ + "/cgroup.procs";
+        return ChildProcess(exe,args,flags,[procs,init](){
+            if (!put(procs,"0")) {
+                throw std::runtime_error("Error " + std::to_string(errno) + " joining the cgroup");
+            }
+            init();
+        },std::move(env));
+    }
+
+    auto chld = ChildProcess(exe,args,flags | ChildProcess::PGROUP,init,std::move(env));
+    std::lock_guard<std::mutex> _(mutex_);
+    groups_.push_back(chld.pid());
+    if (paused_) ChildProcess::signal(-chld.pid(),SIGSTOP);
+    return chld;
+}
+
+/**
+ * Pause all processes in the group, including their descendants, and wait
+ * until they have stopped (at most one second).
+ *
+ * @returns the freeze latency: the time from the request until all
+ *          processes were stopped. With SIGNALS, only the process group
+ *          leaders (the processes started with `start`) are checked, and
+ *          groups whose leader has been joined aren't paused any more.
+ *
+ * @throws std::exception if the cgroup can't be frozen.
+ */
+std::chrono::nanoseconds JobGroup::pause() {
+    std::lock_guard<std::mutex> _(mutex_);
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + stop_timeout;
+    paused_ = true;
+
+    if (mode_==CGROUP) {
+        const auto fd = open((path_ + "/cgroup.events").c_str(),O_RDONLY | O_CLOEXEC);
+        if (fd<0 || !put(path_ + "/cgroup.freeze","1")) {
+            const auto err = errno;
+            if (fd>=0) close(fd);
+            throw std::runtime_error("Error " + std::to_string(err) + " freezing the cgroup");
+        }
+
+        // The kernel signals changes of cgroup.events with POLLPRI
+        char buf[256];
+        for(;;) {
+            const auto n = pread(fd,buf,sizeof(buf)-1,0);
+            if (n<=0) break;
+            buf[n] = 0;
+            if (strstr(buf,"frozen 1")) break;
+            const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline-std::chrono::steady_clock::now()).count();
+            if (left<=0) break;
+            pollfd pfd = { fd, POLLPRI, 0 };
+            poll(&pfd,1,left);
+        }
+        close(fd);
+    } else {
+        // Forget groups whose leader has been waited for, so a reused
+        // PID can't make us stop someone else's processes
+        for(auto g=groups_.begin();g!=groups_.end();) {
+            g = ChildProcess::signal(-*g,SIGSTOP) ? std::next(g) : groups_.erase(g);
+        }
+        for(const auto pid : groups_) {
+            while(!stopped(pid) && std::chrono::steady_clock::now()<deadline) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    return std::chrono::steady_clock::now()-start;
+}
+
+/**
+ * Resume all processes in the group.
+ */
+void JobGroup::resume() {
+    std::lock_guard<std::mutex> _(mutex_);
+    paused_ = false;
+    if (mode_==CGROUP) {
+        put(path_ + "/cgroup.freeze","0");
+    } else {
+        for(const auto pid : groups_) ChildProcess::signal(-pid,SIGCONT);
+    }
+}
+
+/*
+ * Create our cgroup below our own one.
+ */
+bool JobGroup::make_cgroup() {
+    static std::atomic<unsigned> count{0};
+    parent_ = own_cgroup();
+    if (parent_.empty()) return false;
+    path_ = parent_ + "/childprocess-" + std::to_string(getpid()) + "-" + std::to_string(count++);
+    if (mkdir(path_.c_str(),0755)!=0) return false;
+    if (access((path_ + "/cgroup.freeze").c_str(),W_OK)!=0) {
+        rmdir(path_.c_str());
+        return false;
+    }
+    return true;
+}
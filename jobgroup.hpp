@@ -0,0 +1,85 @@
+/**
+ * @brief Child process group pause/resume header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "childprocess.hpp"
+
+/**
+ * Group of child processes, including all their descendants, that can be
+ * paused and resumed together, e. g. to make room for urgent work.
+ *
+ * Uses the cgroup v2 freezer where possible: the group is a cgroup below
+ * our own, processes join it before they exec, and pausing is one write to
+ * cgroup.freeze that freezes everything in it atomically. Otherwise (no
+ * cgroup2 mount, or no permission to create cgroups), each process becomes
+ * the leader of a new process group, and pausing sends SIGSTOP to all of
+ * these groups.
+ *
+ *      JobGroup batch;
+ *      auto a = batch.start("/usr/bin/make",{ "-j8" });
+ *      auto b = batch.start("/usr/bin/make",{ "-C", "other", "-j8" });
+ *      ...
+ *      batch.pause();      // Everything stops
+ *      ...
+ *      batch.resume();
+ *
+ * The dtor resumes the processes and moves those still running back to our
+ * cgroup.
+ */
+class JobGroup {
+public:
+    // How processes are paused
+    enum Mode {
+        AUTO,                               ///< CGROUP if possible, otherwise SIGNALS
+        CGROUP,                             ///< cgroup v2 freezer
+        SIGNALS                             ///< SIGSTOP/SIGCONT to process groups
+    };
+
+    explicit JobGroup(Mode mode=AUTO);
+    ~JobGroup();
+
+    JobGroup(const JobGroup&) = delete;
+    void operator=(const JobGroup&) = delete;
+
+    // Start a process in the group (see the ChildProcess ctor)
+    ChildProcess start(
+        const std::string& exe,
+        const std::vector<std::string>& args={},
+        int flags=0,
+        std::function<void()> init=[](){},
+        EnvBlock env={}
+    );
+
+    // Pause all processes; returns the time until all were stopped
+    std::chrono::nanoseconds pause();
+
+    // Resume all processes
+    void resume();
+
+    Mode mode() const { return mode_; }
+    bool paused() const { return paused_; }
+    const std::string& cgroup() const { return path_; }
+
+private:
+    Mode mode_;
+    std::string path_;                      // cgroup directory (CGROUP)
+    std::string parent_;                    // Our own cgroup directory (CGROUP)
+    std::mutex mutex_;
+    std::vector<pid_t> groups_;             // Process group IDs (SIGNALS)
+    bool paused_ = false;
+
+    bool make_cgroup();
+};
@@ -0,0 +1,265 @@
+/**
+ * @brief Shared append-only job log implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "joblog.hpp"
+
+namespace {
+
+const char magic[] = "CPJOBLG1";
+const size_t file_header = 16;
+
+// Record header
+struct Header {
+    uint32_t length;                        // Of the data; written last
+    uint32_t job;
+    int64_t time;                           // Nanoseconds since the epoch
+    uint8_t stream;
+    uint8_t reserved[3];
+    uint32_t size;                          // Of the record; written first
+};
+static_assert(sizeof(Header)==24,"Unexpected record header size");
+
+/*
+ * Size of a record including header and padding.
+ */
+size_t record_size(size_t length) {
+    return (sizeof(Header)+length+7) & ~size_t(7);
+}
+
+/*
+ * Name of a segment file.
+ */
+std::string segment_name(const std::string& dir,unsigned n) {
+    char name[32];
+    snprintf(name,sizeof(name),"/segment-%06u.log",n);
+    return dir + name;
+}
+
+/*
+ * Read-only mapping of a segment file.
+ */
+class Mapping {
+public:
+    explicit Mapping(const std::string& path) {
+        const auto fd = open(path.c_str(),O_RDONLY | O_CLOEXEC);
+        if (fd<0) {
+            throw std::runtime_error("Error " + std::to_string(errno) + " opening " + path);
+        }
+        struct stat st;
+        if (fstat(fd,&st)==0 && size_t(st.st_size)>file_header) {
+            size_ = st.st_size;
+            base_ = static_cast<const char*>(mmap(nullptr,size_,PROT_READ,MAP_SHARED,fd,0));
+            if (base_==MAP_FAILED) base_ = nullptr;
+        }
+        close(fd);
+        if (base_ && std::memcmp(base_,magic,sizeof(magic)-1)!=0) {
+            throw std::runtime_error("Not a job log segment: " + path);
+        }
+    }
+
+    ~Mapping() {
+        if (base_) munmap(const_cast<char*>(base_),size_);
+    }
+
+    // Call fct for every complete record
+    template<typename Fct>
+    void scan(Fct fct) const {
+        if (!base_) return;
+        for(auto pos=file_header;pos+sizeof(Header)<=size_;) {
+            const auto h = reinterpret_cast<const Header*>(base_+pos);
+            const auto length = __atomic_load_n(&h->length,__ATOMIC_ACQUIRE);
+            if (length==0) {
+                // Not published (yet): skip the reserved space, if known
+                const auto size = __atomic_load_n(&h->size,__ATOMIC_RELAXED);
+                if (size==0 || pos+size>size_) break;
+                pos += size;
+                continue;
+            }
+            if (pos+record_size(length)>size_) break;
+            fct(*h,std::string_view(base_+pos+sizeof(Header),length));
+            pos += record_size(length);
+        }
+    }
+
+private:
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace
+
+// A writable segment, unmapped when the last writer is done with it. The
+// file is sparse, so unused space at the end takes no disk space. (It isn't
+// trimmed, since that would crash readers that mapped it.)
+struct JobLog::Segment {
+    int fd = -1;
+    char* base = nullptr;
+    size_t size = 0;
+    std::atomic<size_t> used{file_header};
+
+    Segment(const std::string& path,size_t sz) : size(sz) {
+        fd = open(path.c_str(),O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC,0644);
+        if (fd<0) {
+            throw std::runtime_error("Error " + std::to_string(errno) + " creating " + path);
+        }
+        if (ftruncate(fd,size)!=0) {
+            const auto err = errno;
+            close(fd);
+            throw std::runtime_error("Error " + std::to_string(err) + " sizing " + path);
+        }
+        const auto p = mmap(nullptr,size,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+        if (p==MAP_FAILED) {
+            const auto err = errno;
+            close(fd);
+            throw std::runtime_error("Error " + std::to_string(err) + " mapping " + path);
+        }
+        base = static_cast<char*>(p);
+        std::memcpy(base,magic,sizeof(magic)-1);
+    }
+
+    ~Segment() {
+        munmap(base,size);
+        close(fd);
+    }
+};
+
+/**
+ * Open a job log.
+ *
+ * @param dir Directory for the segment files; created if needed.
+ * @param segment_size Size of each segment file. Chunks larger than a
+ *                     segment are split into several records.
+ *
+ * @throws std::exception if the first segment can't be created.
+ */
+JobLog::JobLog(const std::string& dir,size_t segment_size)
+: dir_(dir)
+, size_(std::max(segment_size,file_header+record_size(4096))) {
+    std::filesystem::create_directories(dir_);
+    while(std::filesystem::exists(segment_name(dir_,next_))) ++next_;
+    std::atomic_store(&current_,std::make_shared<Segment>(segment_name(dir_,next_++),size_));
+    ++segments_;
+}
+
+/**
+ * Close the log. All sinks must be done.
+ */
+JobLog::~JobLog() = default;
+
+/**
+ * Get a function that appends chunks of one job's stream, for read_stdout
+ * or read_stderr.
+ */
+ChildProcess::Chunk JobLog::sink(uint32_t job,Stream stream) {
+    return [this,job,stream](std::string_view chunk) { append(job,stream,chunk); };
+}
+
+/**
+ * Append a chunk.
+ *
+ * @throws std::exception if a new segment is needed and can't be created.
+ */
+void JobLog::append(uint32_t job,Stream stream,std::string_view data) {
+    const auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+    const auto max = size_ - file_header - sizeof(Header);
+
+    while(!data.empty()) {
+        const auto length = std::min(data.size(),max);
+        const auto need = record_size(length);
+
+        // Reserve space in the current segment
+        const auto seg = std::atomic_load(&current_);
+        const auto pos = seg->used.fetch_add(need);
+        if (pos+need>seg->size) {
+            rotate(seg);
+            continue;
+        }
+
+        // Note the reserved size, fill the record, then publish it by
+        // setting the length
+        const auto h = reinterpret_cast<Header*>(seg->base+pos);
+        __atomic_store_n(&h->size,static_cast<uint32_t>(need),__ATOMIC_RELAXED);
+        h->job = job;
+        h->time = time;
+        h->stream = stream;
+        std::memcpy(seg->base+pos+sizeof(Header),data.data(),length);
+        __atomic_store_n(&h->length,static_cast<uint32_t>(length),__ATOMIC_RELEASE);
+        data.remove_prefix(length);
+    }
+}
+
+/*
+ * Start a new segment after `full`, unless another writer did so already.
+ */
+void JobLog::rotate(const std::shared_ptr<Segment>& full) {
+    std::lock_guard<std::mutex> _(mutex_);
+    if (std::atomic_load(&current_)!=full) return;
+    std::atomic_store(&current_,std::make_shared<Segment>(segment_name(dir_,next_++),size_));
+    ++segments_;
+}
+
+/**
+ * Open a job log for reading.
+ *
+ * @param dir Directory of the segment files.
+ */
+JobLogReader::JobLogReader(const std::string& dir) {
+    for(unsigned n=0;std::filesystem::exists(segment_name(dir,n));++n) {
+        files_.push_back(segment_name(dir,n));
+    }
+}
+
+/**
+ * Call a function for every record in the log. Records of different jobs
+ * are in the order their space was reserved.
+ */
+void JobLogReader::scan(const std::function<void(const Record&)>& fct) const {
+    for(const auto& file : files_) {
+        Mapping(file).scan([&fct](const Header& h,std::string_view data) {
+            fct({
+                h.job,
+                static_cast<JobLog::Stream>(h.stream),
+                std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(h.time))),
+                data
+            });
+        });
+    }
+}
+
+/**
+ * Get one job's stream chunk by chunk, without copying. Other jobs' records
+ * are skipped by their header only.
+ */
+void JobLogReader::extract(uint32_t job,JobLog::Stream stream,const ChildProcess::Chunk& fct) const {
+    for(const auto& file : files_) {
+        Mapping(file).scan([&](const Header& h,std::string_view data) {
+            if (h.job==job && h.stream==stream) fct(data);
+        });
+    }
+}
+
+/**
+ * Get one job's stream.
+ */
+std::string JobLogReader::extract(uint32_t job,JobLog::Stream stream) const {
+    std::string ret;
+    extract(job,stream,[&ret](std::string_view data) { ret.append(data); });
+    return ret;
+}
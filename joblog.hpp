@@ -0,0 +1,111 @@
+/**
+ * @brief Shared append-only job log header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "childprocess.hpp"
+
+/**
+ * Append-only log for the output of many child processes.
+ *
+ * Instead of a buffer or file per process, all output chunks go into one
+ * log as records tagged with a job ID, the stream, and a timestamp. The log
+ * is a directory of fixed-size, memory-mapped segment files; a new segment
+ * is started when the current one is full. Writers reserve space with an
+ * atomic add and copy their chunk without a lock; only starting a new
+ * segment takes one.
+ *
+ *      JobLog log("/var/tmp/jobs");
+ *      ChildProcess chld(..., ChildProcess::OUT | ChildProcess::ERR);
+ *      auto out = chld.read_stdout(log.sink(42,JobLog::STDOUT));
+ *      auto err = chld.read_stderr(log.sink(42,JobLog::STDERR));
+ *      ...
+ *      std::string output = JobLogReader("/var/tmp/jobs").extract(42,JobLog::STDOUT);
+ *
+ * Segment format: the magic "CPJOBLG1" and 8 reserved bytes, then records
+ * of a 24 byte header (data length, job ID, nanoseconds since the epoch,
+ * stream, record size) and the data, padded to 8 bytes. The record size is
+ * written first and the data length last, so readers never see a partial
+ * record, and skip records that are still being written or whose writer
+ * died before finishing them. A record size of 0 marks the end of the
+ * segment; if a writer dies in the few instructions between reserving the
+ * space and writing the record size, readers stop there and the rest of
+ * that segment is lost.
+ */
+class JobLog {
+public:
+    // Streams
+    enum Stream : uint8_t { STDOUT = 1, STDERR = 2 };
+
+    // Open a log, continuing after existing segments
+    explicit JobLog(const std::string& dir,size_t segment_size=64<<20);
+    ~JobLog();
+
+    JobLog(const JobLog&) = delete;
+    JobLog& operator=(const JobLog&) = delete;
+
+    // Chunk function to be passed to ChildProcess::read_stdout/read_stderr
+    ChildProcess::Chunk sink(uint32_t job,Stream stream);
+
+    // Append a chunk. Thread-safe.
+    void append(uint32_t job,Stream stream,std::string_view data);
+
+    // Number of segments started by this log
+    unsigned segments() const { return segments_; }
+
+private:
+    struct Segment;
+
+    const std::string dir_;
+    const size_t size_;
+    std::mutex mutex_;                      // For starting a new segment
+    std::shared_ptr<Segment> current_;      // Accessed with std::atomic_load/store
+    unsigned next_ = 0;                     // Number of the next segment file
+    std::atomic<unsigned> segments_{0};
+
+    void rotate(const std::shared_ptr<Segment>& full);
+};
+
+/**
+ * Reader of a JobLog directory. Can be used while the log is written; it
+ * then doesn't see the records that are still being written.
+ */
+class JobLogReader {
+public:
+    // One record
+    struct Record {
+        uint32_t job;
+        JobLog::Stream stream;
+        std::chrono::system_clock::time_point time;
+        std::string_view data;              ///< Valid only during the callback
+    };
+
+    explicit JobLogReader(const std::string& dir);
+
+    // Call fct for every record, in log order
+    void scan(const std::function<void(const Record&)>& fct) const;
+
+    // Call fct with the data of one job's stream, chunk by chunk
+    void extract(uint32_t job,JobLog::Stream stream,const ChildProcess::Chunk& fct) const;
+
+    // Get the data of one job's stream
+    std::string extract(uint32_t job,JobLog::Stream stream) const;
+
+private:
+    std::vector<std::string> files_;
+};
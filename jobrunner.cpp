@@ -0,0 +1,310 @@
+/**
+ * @brief Job scheduling and scheduler simulation implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "childprocess.hpp"
+#include "jobrunner.hpp"
+
+namespace {
+
+using us = std::chrono::microseconds;
+
+// First line of a history file
+const char header[] = "name\tpriority\testimate_us\tmemory\tat_us\tstart_us\tend_us\tstatus\tuser_us\tsystem_us\tmax_rss";
+
+/*
+ * Waiting jobs in policy order. Used for real and for simulated runs, so
+ * both make the same decisions.
+ */
+class Queue {
+public:
+    // What the policies look at
+    struct Entry {
+        size_t job;
+        int priority;
+        us estimate;
+        us at;
+    };
+
+    explicit Queue(JobRunner::Policy policy)
+    : queue_([policy](const Entry& a,const Entry& b){
+        // "Less" means "runs later"; ties go by arrival, then submission
+        switch(policy) {
+            case JobRunner::SJF:      if (a.estimate!=b.estimate) return a.estimate>b.estimate; break;
+            case JobRunner::PRIORITY: if (a.priority!=b.priority) return a.priority<b.priority; break;
+            case JobRunner::FIFO:     break;
+        }
+        return a.at!=b.at ? a.at>b.at : a.job>b.job;
+    }) {}
+
+    void push(const Entry& e) { queue_.push(e); }
+    bool empty() const { return queue_.empty(); }
+    size_t top() const { return queue_.top().job; }
+    void pop() { queue_.pop(); }
+
+private:
+    std::priority_queue<Entry,std::vector<Entry>,std::function<bool(const Entry&,const Entry&)>> queue_;
+};
+
+/*
+ * Check if another job may start.
+ */
+bool fits(const JobRunner::Limits& limits,unsigned running,unsigned long long used,unsigned long long memory) {
+    if (running==0) return true;
+    if (running>=limits.slots) return false;
+    return !limits.memory || used+memory<=limits.memory;
+}
+
+/*
+ * Indices of jobs in order of arrival.
+ */
+template<typename T>
+std::vector<size_t> by_arrival(const std::vector<T>& jobs) {
+    std::vector<size_t> ret(jobs.size());
+    std::iota(ret.begin(),ret.end(),0);
+    std::stable_sort(ret.begin(),ret.end(),[&jobs](size_t a,size_t b){ return jobs[a].at<jobs[b].at; });
+    return ret;
+}
+
+} // namespace
+
+/**
+ * Add a job, to be started by `run`.
+ */
+void JobRunner::submit(Job job) {
+    jobs_.push_back(std::move(job));
+}
+
+/**
+ * Run the submitted jobs, each when it has arrived and the policy and
+ * limits let it start, and wait until all have terminated. Jobs that can't
+ * be started are recorded with status -1.
+ *
+ * @returns what happened, in the order the jobs were submitted.
+ */
+std::vector<JobRunner::Record> JobRunner::run() {
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto elapsed = [t0](){ return std::chrono::duration_cast<us>(std::chrono::steady_clock::now()-t0); };
+
+    std::vector<Record> records(jobs_.size());
+    for(size_t i=0;i<jobs_.size();++i) {
+        const auto& j = jobs_[i];
+        auto& r = records[i];
+        r.name = j.name;
+        r.priority = j.priority;
+        r.estimate = j.estimate;
+        r.memory = j.memory;
+        r.at = j.at;
+    }
+
+    const auto order = by_arrival(jobs_);
+    Queue queue(limits_.policy);
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::thread> threads;
+    unsigned running = 0;
+    unsigned long long used = 0;
+    size_t next = 0, done = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while(done<jobs_.size()) {
+        const auto now = elapsed();
+        for(;next<order.size() && jobs_[order[next]].at<=now;++next) {
+            const auto& j = jobs_[order[next]];
+            queue.push({ order[next], j.priority, j.estimate, j.at });
+        }
+
+        // Start what may start; each job is waited for by its own thread
+        while(!queue.empty() && fits(limits_,running,used,jobs_[queue.top()].memory)) {
+            const auto i = queue.top();
+            queue.pop();
+            ++running;
+            used += jobs_[i].memory;
+            records[i].start = elapsed();
+            threads.emplace_back([&,i](){
+                auto status = -1;
+                ChildProcess::Usage usage;
+                try {
+                    ChildProcess chld(jobs_[i].exe,jobs_[i].args);
+                    status = chld.join();
+                    usage = chld.usage();
+                } catch(const std::exception&) {
+                    // Recorded with status -1
+                }
+
+                std::lock_guard<std::mutex> _(mutex);
+                auto& r = records[i];
+                r.end = elapsed();
+                r.status = status;
+                r.user = usage.user;
+                r.system = usage.system;
+                r.max_rss = usage.max_rss;
+                --running;
+                used -= jobs_[i].memory;
+                ++done;
+                cv.notify_all();
+            });
+        }
+
+        // Wait for a job to terminate or to arrive
+        if (done==jobs_.size()) break;
+        if (next<order.size()) {
+            cv.wait_until(lock,t0+jobs_[order[next]].at);
+        } else {
+            cv.wait(lock);
+        }
+    }
+    lock.unlock();
+
+    for(auto& t : threads) t.join();
+    jobs_.clear();
+    return records;
+}
+
+/**
+ * Replay a history in virtual time: the jobs arrive when they did, and
+ * are started as the policy and limits say. Each job takes as long as it
+ * did, and needs its declared memory, or its peak RSS if none was
+ * declared. SJF uses the estimated duration, or the real one if there's
+ * no estimate.
+ *
+ * @returns the simulated schedule, in the order of the history.
+ */
+std::vector<JobRunner::Record> JobRunner::simulate(const std::vector<Record>& history,Limits limits) {
+    const auto memory = [&history](size_t i){ return history[i].memory ? history[i].memory : history[i].max_rss; };
+
+    std::vector<Record> ret(history);
+    const auto order = by_arrival(history);
+    Queue queue(limits.policy);
+
+    // Running jobs by termination time, earliest first
+    using Event = std::pair<us,size_t>;
+    std::priority_queue<Event,std::vector<Event>,std::greater<Event>> running;
+    unsigned long long used = 0;
+    size_t next = 0, done = 0;
+
+    for(auto now=us(0);done<history.size();) {
+        for(;!running.empty() && running.top().first<=now;running.pop()) {
+            used -= memory(running.top().second);
+            ++done;
+        }
+        for(;next<order.size() && history[order[next]].at<=now;++next) {
+            const auto& h = history[order[next]];
+            queue.push({ order[next], h.priority, h.estimate.count() ? h.estimate : h.duration(), h.at });
+        }
+        while(!queue.empty() && fits(limits,running.size(),used,memory(queue.top()))) {
+            const auto i = queue.top();
+            queue.pop();
+            ret[i].start = now;
+            ret[i].end = now + history[i].duration();
+            used += memory(i);
+            running.push({ ret[i].end, i });
+        }
+
+        // Skip to the next event
+        auto then = us::max();
+        if (!running.empty()) then = running.top().first;
+        if (next<order.size()) then = std::min(then,history[order[next]].at);
+        if (then==us::max()) break;
+        now = then;
+    }
+    return ret;
+}
+
+/**
+ * Summarize a schedule (recorded or simulated).
+ *
+ * @param schedule The jobs.
+ * @param slots Jobs that could run at the same time, for the utilization.
+ */
+JobRunner::Report JobRunner::report(const std::vector<Record>& schedule,unsigned slots) {
+    Report ret;
+    if (schedule.empty()) return ret;
+
+    std::vector<us> waits;
+    auto busy = us(0), cpu = us(0);
+    for(const auto& r : schedule) {
+        ret.makespan = std::max(ret.makespan,r.end);
+        waits.push_back(r.wait());
+        busy += r.duration();
+        cpu += r.user + r.system;
+    }
+
+    std::sort(waits.begin(),waits.end());
+    ret.mean_wait = std::accumulate(waits.begin(),waits.end(),us(0))/waits.size();
+    ret.p50_wait = waits[waits.size()/2];
+    ret.p95_wait = waits[std::min(waits.size()-1,waits.size()*95/100)];
+    ret.max_wait = waits.back();
+    if (ret.makespan.count()>0 && slots>0) {
+        ret.utilization = double(busy.count())/(double(ret.makespan.count())*slots);
+        ret.cpu_utilization = double(cpu.count())/(double(ret.makespan.count())*slots);
+    }
+    return ret;
+}
+
+/**
+ * Save a history as tab-separated text, with a header line.
+ *
+ * @throws std::exception if the file can't be written.
+ */
+void JobRunner::save(const std::string& path,const std::vector<Record>& history) {
+    std::ofstream ofs(path);
+    ofs << header << "\n";
+    for(const auto& r : history) {
+        ofs << r.name << "\t" << r.priority << "\t" << r.estimate.count() << "\t" << r.memory
+            << "\t" << r.at.count() << "\t" << r.start.count() << "\t" << r.end.count()
+            << "\t" << r.status << "\t" << r.user.count() << "\t" << r.system.count()
+            << "\t" << r.max_rss << "\n";
+    }
+    ofs.close();
+    if (!ofs) {
+        throw std::runtime_error("Error writing " + path);
+    }
+}
+
+/**
+ * Load a history saved with `save`.
+ *
+ * @throws std::exception if the file can't be read or is malformed.
+ */
+std::vector<JobRunner::Record> JobRunner::load(const std::string& path) {
+    std::ifstream ifs(path);
+    std::string line;
+    if (!std::getline(ifs,line) || line!=header) {
+        throw std::runtime_error("Not a job history: " + path);
+    }
+
+    std::vector<Record> ret;
+    while(std::getline(ifs,line)) {
+        std::istringstream is(line);
+        Record r;
+        long long estimate, at, start, end, user, system;
+        if (!std::getline(is,r.name,'\t')
+            || !(is >> r.priority >> estimate >> r.memory >> at >> start >> end >> r.status >> user >> system >> r.max_rss)) {
+            throw std::runtime_error("Malformed job history: " + path);
+        }
+        r.estimate = us(estimate);
+        r.at = us(at);
+        r.start = us(start);
+        r.end = us(end);
+        r.user = us(user);
+        r.system = us(system);
+        ret.push_back(std::move(r));
+    }
+    return ret;
+}
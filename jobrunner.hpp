@@ -0,0 +1,121 @@
+/**
+ * @brief Job scheduling and scheduler simulation header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * Runs a set of jobs (child processes) with a concurrency limit, an
+ * optional memory budget, and a scheduling policy that decides which
+ * waiting job starts next, and records what happened:
+ *
+ *      JobRunner runner({ JobRunner::SJF, 8, 16ULL<<30 });
+ *      runner.submit({ "index", "/usr/bin/indexer", { "--all" }, 0, std::chrono::minutes(5), 4ULL<<30 });
+ *      ...
+ *      const auto history = runner.run();
+ *      JobRunner::save("history.tsv",history);
+ *
+ * The same policies can be run in virtual time, replaying a recorded
+ * history with other limits or policies to see how they would have done,
+ * without running anything:
+ *
+ *      const auto history = JobRunner::load("history.tsv");
+ *      for(auto policy : { JobRunner::FIFO, JobRunner::SJF, JobRunner::PRIORITY }) {
+ *          const auto r = JobRunner::report(JobRunner::simulate(history,{ policy, 4 }),4);
+ *          ...
+ *      }
+ *
+ * The simulation takes each job's arrival time, duration, and memory
+ * (declared, or else the peak RSS measured) from the history, and assumes
+ * durations don't depend on what else is running.
+ *
+ * A job whose memory alone exceeds the budget runs when nothing else does.
+ * Jobs are started strictly in policy order: when the next job doesn't fit
+ * into the memory left, later jobs wait as well.
+ */
+class JobRunner {
+public:
+    // Which waiting job starts next
+    enum Policy {
+        FIFO,                           ///< Earliest arrival
+        SJF,                            ///< Shortest estimated duration (shortest job first)
+        PRIORITY                        ///< Highest priority
+    };
+
+    // How many jobs may run
+    struct Limits {
+        Policy policy = FIFO;
+        unsigned slots = 1;             ///< Jobs running at the same time
+        unsigned long long memory = 0;  ///< Memory of the jobs running at the same time (bytes, 0: unlimited)
+    };
+
+    // A job to run
+    struct Job {
+        std::string name;
+        std::string exe;
+        std::vector<std::string> args;
+        int priority = 0;                       ///< Higher runs first (PRIORITY)
+        std::chrono::microseconds estimate{0};  ///< Expected duration (SJF)
+        unsigned long long memory = 0;          ///< Expected peak memory (bytes)
+        std::chrono::microseconds at{0};        ///< Arrival, relative to the start of `run`
+    };
+
+    // What happened to a job; times are relative to the start
+    struct Record {
+        std::string name;
+        int priority = 0;
+        std::chrono::microseconds estimate{0};
+        unsigned long long memory = 0;          ///< Declared memory
+        std::chrono::microseconds at{0};        ///< Arrival
+        std::chrono::microseconds start{0};     ///< Start
+        std::chrono::microseconds end{0};       ///< Termination
+        int status = -1;                        ///< Exit status
+        std::chrono::microseconds user{0};      ///< User CPU time
+        std::chrono::microseconds system{0};    ///< System CPU time
+        unsigned long long max_rss = 0;         ///< Peak RSS (bytes)
+
+        std::chrono::microseconds wait() const { return start-at; }
+        std::chrono::microseconds duration() const { return end-start; }
+    };
+
+    // Summary of a schedule
+    struct Report {
+        std::chrono::microseconds makespan{0};  ///< Until the last job terminated
+        std::chrono::microseconds mean_wait{0}; ///< Queueing delay: mean,
+        std::chrono::microseconds p50_wait{0};  ///< median,
+        std::chrono::microseconds p95_wait{0};  ///< 95th percentile,
+        std::chrono::microseconds max_wait{0};  ///< and maximum
+        double utilization = 0;                 ///< Busy share of the slots
+        double cpu_utilization = 0;             ///< CPU time per slot time
+    };
+
+    explicit JobRunner(Limits limits) : limits_(limits) {}
+
+    // Add a job
+    void submit(Job job);
+
+    // Run the jobs submitted, and wait until all are done
+    std::vector<Record> run();
+
+    // Replay a history in virtual time; returns the simulated schedule
+    static std::vector<Record> simulate(const std::vector<Record>& history,Limits limits);
+
+    // Summarize a schedule
+    static Report report(const std::vector<Record>& schedule,unsigned slots);
+
+    // Save and load a history (tab-separated, one job per line)
+    static void save(const std::string& path,const std::vector<Record>& history);
+    static std::vector<Record> load(const std::string& path);
+
+private:
+    Limits limits_;
+    std::vector<Job> jobs_;
+};
@@ -0,0 +1,142 @@
+/**
+ * @brief Line offset index implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <stdexcept>
+
+#include "lineindex.hpp"
+#include "simd.hpp"
+
+/**
+ * Index the next chunk of the stream.
+ */
+void LineIndex::add(std::string_view chunk) {
+    const auto begin = chunk.data();
+    const auto end = begin + chunk.size();
+    for(auto p=begin;(p=find_byte(p,end,'\n'))!=end;++p) {
+        const auto offset = bytes_ + (p-begin);
+        if (newlines_%stride==0) {
+            checkpoints_.push_back({ offset, deltas_.size() });
+        } else {
+            for(auto d=offset-last_;;d>>=7) {
+                if (d<0x80) {
+                    deltas_.push_back(static_cast<uint8_t>(d));
+                    break;
+                }
+                deltas_.push_back(static_cast<uint8_t>(d | 0x80));
+            }
+        }
+        last_ = offset;
+        ++newlines_;
+    }
+    bytes_ += chunk.size();
+}
+
+/**
+ * Get the number of lines so far, including an unterminated last line.
+ */
+size_t LineIndex::lines() const {
+    const auto partial = bytes_>(newlines_ ? last_+1 : 0);
+    return newlines_ + partial;
+}
+
+/**
+ * Get the start and end offset of a line, not including the newline.
+ *
+ * @throws std::exception if there is no such line.
+ */
+std::pair<uint64_t,uint64_t> LineIndex::range(size_t line) const {
+    if (line>=lines()) {
+        throw std::out_of_range("No line " + std::to_string(line) + " (have " + std::to_string(lines()) + ")");
+    }
+    const auto begin = line ? newline(line-1)+1 : 0;
+    const auto end = line<newlines_ ? newline(line) : bytes_;
+    return { begin, end };
+}
+
+/**
+ * Get the size of the index in bytes.
+ */
+size_t LineIndex::memory() const {
+    return checkpoints_.size()*sizeof(Checkpoint) + deltas_.size();
+}
+
+/*
+ * Get the offset of newline number n, starting at the nearest checkpoint.
+ */
+uint64_t LineIndex::newline(uint64_t n) const {
+    const auto& cp = checkpoints_[n/stride];
+    auto offset = cp.offset;
+    auto pos = cp.pos;
+    for(auto i=n%stride;i>0;--i) {
+        uint64_t d = 0;
+        for(auto shift=0;;shift+=7) {
+            const auto c = deltas_[pos++];
+            d |= uint64_t(c & 0x7f) << shift;
+            if (!(c & 0x80)) break;
+        }
+        offset += d;
+    }
+    return offset;
+}
+
+/**
+ * Get a function that appends to the capture, for read_stdout or read_stderr.
+ */
+ChildProcess::Chunk LineCapture::sink() {
+    return [this](std::string_view chunk) { add(chunk); };
+}
+
+/**
+ * Append a chunk to the capture.
+ */
+void LineCapture::add(std::string_view chunk) {
+    std::lock_guard<std::mutex> _(mutex_);
+    data_.append(chunk);
+    index_.add(chunk);
+}
+
+/**
+ * Get the number of lines captured.
+ */
+size_t LineCapture::lines() const {
+    std::lock_guard<std::mutex> _(mutex_);
+    return index_.lines();
+}
+
+/**
+ * Get one line, without the newline.
+ *
+ * @throws std::exception if there is no such line.
+ */
+std::string LineCapture::line(size_t n) const {
+    std::lock_guard<std::mutex> _(mutex_);
+    const auto r = index_.range(n);
+    return data_.substr(r.first,r.second-r.first);
+}
+
+/**
+ * Get a range of lines, with their newlines. Stops at the last line.
+ *
+ * @throws std::exception if there is no line `first`.
+ */
+std::string LineCapture::lines(size_t first,size_t count) const {
+    std::lock_guard<std::mutex> _(mutex_);
+    if (count==0) return {};
+    const auto begin = index_.range(first).first;
+    const auto last = std::min(first+count,index_.lines())-1;
+    const auto end = std::min<uint64_t>(index_.range(last).second+1,data_.size());
+    return data_.substr(begin,end-begin);
+}
+
+/**
+ * Get everything captured.
+ */
+std::string LineCapture::data() const {
+    std::lock_guard<std::mutex> _(mutex_);
+    return data_;
+}
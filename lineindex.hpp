@@ -0,0 +1,104 @@
+/**
+ * @brief Line offset index header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "childprocess.hpp"
+
+/**
+ * Index of the line positions in a stream of bytes, built while the bytes
+ * stream in, for random access to line N later.
+ *
+ * Stores the offset of every newline as the distance to the previous one,
+ * as varint (one byte for lines shorter than 128 bytes), plus the absolute
+ * offset of every `stride`th newline. Finding a line decodes at most
+ * stride-1 varints from the nearest checkpoint, no matter how large the
+ * stream is.
+ *
+ * Lines are numbered from 0. Line ranges don't include the newline. Data
+ * after the last newline is a line as well.
+ */
+class LineIndex {
+public:
+    static constexpr size_t stride = 64;
+
+    // Index the next chunk of the stream
+    void add(std::string_view chunk);
+
+    // Number of lines so far
+    size_t lines() const;
+
+    // Start and end offset of a line
+    std::pair<uint64_t,uint64_t> range(size_t line) const;
+
+    // Stream size so far
+    uint64_t bytes() const { return bytes_; }
+
+    // Size of the index in bytes
+    size_t memory() const;
+
+private:
+    struct Checkpoint {
+        uint64_t offset;                    // Of newline number n*stride
+        uint64_t pos;                       // Of the next delta in deltas_
+    };
+    std::vector<Checkpoint> checkpoints_;
+    std::vector<uint8_t> deltas_;
+    uint64_t newlines_ = 0;
+    uint64_t last_ = 0;                     // Offset of the last newline
+    uint64_t bytes_ = 0;
+
+    uint64_t newline(uint64_t n) const;
+};
+
+/**
+ * Captured output of a child process with a line index.
+ *
+ *      ChildProcess chld(..., ChildProcess::OUT);
+ *      LineCapture cap;
+ *      auto out = chld.read_stdout(cap.sink());
+ *      out.get();
+ *      chld.join();
+ *      std::cout << cap.line(123456) << "\n";
+ *
+ * Reading from the capture while the process still writes is safe.
+ */
+class LineCapture {
+public:
+    // Chunk function to be passed to ChildProcess::read_stdout/read_stderr
+    ChildProcess::Chunk sink();
+
+    // Append a chunk
+    void add(std::string_view chunk);
+
+    // Number of lines captured
+    size_t lines() const;
+
+    // One line (without the newline)
+    std::string line(size_t n) const;
+
+    // `count` lines starting with line `first`, with their newlines
+    std::string lines(size_t first,size_t count) const;
+
+    // Everything captured
+    std::string data() const;
+
+    const LineIndex& index() const { return index_; }
+
+private:
+    mutable std::mutex mutex_;
+    std::string data_;
+    LineIndex index_;
+};
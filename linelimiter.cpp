@@ -0,0 +1,103 @@
+/**
+ * @brief Line rate limiter implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include "linelimiter.hpp"
+#include "simd.hpp"
+
+/**
+ * Make a limiter.
+ *
+ * @param next Where the kept lines go.
+ * @param max_lines Lines passed on per interval.
+ * @param interval Length of the interval.
+ * @param sample Of the lines beyond max_lines, pass on every sample-th (0: none).
+ * @param notice Pass on a notice with the number of dropped lines.
+ */
+LineLimiter::LineLimiter(
+    ChildProcess::Chunk next,
+    size_t max_lines,
+    std::chrono::milliseconds interval,
+    size_t sample,
+    bool notice
+)
+: next_(std::move(next))
+, max_(max_lines)
+, interval_(interval)
+, sample_(sample)
+, notice_(notice)
+, window_(std::chrono::steady_clock::now()) {}
+
+/**
+ * Get the chunk function for ChildProcess::read_stdout/read_stderr.
+ */
+ChildProcess::Chunk LineLimiter::sink() {
+    return [this](std::string_view chunk){ (*this)(chunk); };
+}
+
+/**
+ * Process the next chunk: pass on the kept lines.
+ */
+void LineLimiter::operator()(std::string_view chunk) {
+    if (chunk.empty()) {
+        if (notice_ && pending_+dropped_ && mid_line_ && keep_) next_("\n");
+        report(pending_ + dropped_);
+        pending_ = dropped_ = 0;
+        next_(chunk);
+        return;
+    }
+
+    // New interval: the dropped lines are reported at the next line start,
+    // so the notice doesn't end up in the middle of a line
+    const auto now = std::chrono::steady_clock::now();
+    if (now-window_>=interval_) {
+        window_ = now;
+        count_ = 0;
+        pending_ += dropped_;
+        dropped_ = 0;
+    }
+
+    auto p = chunk.data();
+    const auto end = p + chunk.size();
+    const char* run = mid_line_ && keep_ ? p : nullptr;     // Start of the kept lines not passed on yet
+    while(p<end) {
+        if (!mid_line_) {
+            // A line starts: keep it or not
+            if (pending_) {
+                if (run) next_(std::string_view(run,p-run));
+                run = nullptr;
+                report(pending_);
+                pending_ = 0;
+            }
+            ++count_;
+            keep_ = count_<=max_ || (sample_ && (count_-max_)%sample_==0);
+            if (keep_) {
+                passed_.fetch_add(1,std::memory_order_relaxed);
+                if (!run) run = p;
+            } else {
+                suppressed_.fetch_add(1,std::memory_order_relaxed);
+                ++dropped_;
+                if (run) next_(std::string_view(run,p-run));
+                run = nullptr;
+            }
+        }
+
+        const auto nl = find_byte(p,end,'\n');
+        mid_line_ = nl==end;
+        p = mid_line_ ? end : nl+1;
+    }
+    if (run) next_(std::string_view(run,end-run));
+}
+
+/*
+ * Pass on the notice about dropped lines.
+ */
+void LineLimiter::report(unsigned long long count) {
+    if (!notice_ || !count) return;
+    text_ = "[" + std::to_string(count) + " lines suppressed]\n";
+    next_(text_);
+}
@@ -0,0 +1,119 @@
+/**
+ * @brief Child process metrics export implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <sys/resource.h>
+
+#include "childprocess.hpp"
+#include "metrics.hpp"
+
+namespace {
+
+/*
+ * Write the HELP and TYPE lines of a metric.
+ */
+void header(std::ostream& os,const char* name,const char* type,const char* help) {
+    os << "# HELP " << name << " " << help << "\n"
+       << "# TYPE " << name << " " << type << "\n";
+}
+
+/*
+ * Write a metric with a single value.
+ */
+template<typename T>
+void single(std::ostream& os,const char* name,const char* type,const char* help,T value) {
+    header(os,name,type,help);
+    os << name << " " << value << "\n";
+}
+
+/*
+ * Write a histogram metric.
+ */
+void histogram(std::ostream& os,const char* name,const char* help,const ChildProcess::Histogram& h) {
+    header(os,name,"histogram",help);
+
+    auto total = 0ULL;
+    for(size_t i=0;i<=ChildProcess::Histogram::buckets;++i) {
+        total += h.counts[i].load(std::memory_order_relaxed);
+        os << name << "_bucket{le=\"";
+        if (i<ChildProcess::Histogram::buckets) os << ChildProcess::Histogram::bounds[i];
+        else os << "+Inf";
+        os << "\"} " << total << "\n";
+    }
+    os << name << "_sum " << std::setprecision(17) << h.sum_ns.load(std::memory_order_relaxed)/1e9 << std::setprecision(6) << "\n"
+       << name << "_count " << total << "\n";
+}
+
+} // namespace
+
+/**
+ * Render the library's statistics (see ChildProcess::stats,
+ * ChildProcess::total_io_stats, and ChildProcess::live) in the Prometheus
+ * text exposition format.
+ */
+std::string prometheus_metrics() {
+    const auto& stats = ChildProcess::stats();
+    const auto& io = ChildProcess::total_io_stats();
+    std::ostringstream os;
+
+    single(os,"childprocess_spawns_total","counter","Child processes started.",stats.spawns.load());
+    histogram(os,"childprocess_spawn_duration_seconds","Time spent starting a child process.",stats.spawn_latency);
+    single(os,"childprocess_running","gauge","Child processes started and not yet waited for.",ChildProcess::live().size());
+    histogram(os,"childprocess_reap_duration_seconds","Time from the termination request until a child process destroyed while running was reaped.",stats.reap_latency);
+
+    header(os,"childprocess_pipe_bytes_total","counter","Bytes transferred through the pipes.");
+    os << "childprocess_pipe_bytes_total{direction=\"in\"} " << io.bytes_written.load() << "\n"
+       << "childprocess_pipe_bytes_total{direction=\"out\"} " << io.bytes_read.load() << "\n";
+    header(os,"childprocess_pipe_syscalls_total","counter","read and write syscalls on the pipes.");
+    os << "childprocess_pipe_syscalls_total{op=\"write\"} " << io.writes.load() << "\n"
+       << "childprocess_pipe_syscalls_total{op=\"read\"} " << io.reads.load() << "\n";
+    single(os,"childprocess_pipe_partial_writes_total","counter","Pipe writes that wrote less than requested.",io.partial_writes.load());
+    single(os,"childprocess_pipe_eagain_total","counter","Pipe reads and writes that returned EAGAIN.",io.eagains.load());
+    single(os,"childprocess_pipe_epipe_total","counter","Pipe writes that found stdin closed by the process.",io.epipes.load());
+    single(os,"childprocess_pipe_max_fill_bytes","gauge","Most bytes seen waiting in a pipe.",io.max_fill.load());
+    single(os,"childprocess_io_threads","gauge","Running pipe reader and writer threads.",stats.io_threads.load());
+
+    // File descriptor usage of this process
+    auto fds = 0;
+    for(const auto& _ : std::filesystem::directory_iterator("/proc/self/fd")) {
+        (void)_;
+        ++fds;
+    }
+    rlimit lim = {};
+    getrlimit(RLIMIT_NOFILE,&lim);
+    single(os,"childprocess_open_fds","gauge","Open file descriptors of this process.",fds);
+    single(os,"childprocess_max_fds","gauge","File descriptor limit of this process.",lim.rlim_cur);
+
+    return os.str();
+}
+
+/**
+ * Write the output of prometheus_metrics into a file, e. g. for the
+ * node exporter's textfile collector. The file is replaced atomically.
+ *
+ * @throws std::exception if the file can't be written.
+ */
+void write_prometheus_metrics(const std::string& path) {
+    const auto tmp = path + ".tmp";
+    {
+        std::ofstream ofs(tmp);
+        ofs << prometheus_metrics();
+        if (!ofs.flush()) {
+            throw std::runtime_error("Error writing " + tmp);
+        }
+    }
+    if (std::rename(tmp.c_str(),path.c_str())) {
+        const auto err = errno;
+        std::remove(tmp.c_str());
+        throw std::runtime_error("Error " + std::to_string(err) + " renaming " + tmp + " to " + path);
+    }
+}
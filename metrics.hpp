@@ -0,0 +1,17 @@
+/**
+ * @brief Child process metrics export header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <string>
+
+// Render the library's statistics in the Prometheus text format
+std::string prometheus_metrics();
+
+// Write them into a file, replacing it atomically
+void write_prometheus_metrics(const std::string& path);
@@ -0,0 +1,323 @@
+/**
+ * @brief Child process monitor implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "childprocess.hpp"
+#include "monitor.hpp"
+
+namespace {
+
+/*
+ * Read a /proc file from the start into a buffer, null-terminated.
+ */
+bool reread(int fd,char* buf,size_t size) {
+    const auto n = pread(fd,buf,size-1,0);
+    if (n<=0) return false;
+    buf[n] = 0;
+    return true;
+}
+
+/*
+ * Get a value from a "name: value" line of /proc/<pid>/io.
+ */
+unsigned long long io_value(const char* buf,const char* name) {
+    const auto p = strstr(buf,name);
+    return p ? strtoull(p+strlen(name),nullptr,10) : 0;
+}
+
+} // namespace
+
+/**
+ * Start monitoring.
+ *
+ * @param interval Time between samples.
+ * @param history Number of samples kept per process.
+ */
+ProcessMonitor::ProcessMonitor(std::chrono::milliseconds interval,size_t history)
+: interval_(interval)
+, history_(history)
+, thread_([this](){ run(); }) {
+}
+
+/**
+ * Stop monitoring. Waits for the monitor thread to finish.
+ */
+ProcessMonitor::~ProcessMonitor() {
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+
+    for(auto& p : procs_) {
+        close(p.second);
+    }
+}
+
+/**
+ * Add a threshold. `cb` is called in the monitor thread when the metric of
+ * a process rises above `limit`, and again only after it has dropped to or
+ * below the limit in between.
+ */
+void ProcessMonitor::on_threshold(Metric metric,double limit,Callback cb) {
+    std::lock_guard<std::mutex> _(mutex_);
+    thresholds_.push_back({ metric, limit, std::move(cb) });
+}
+
+/**
+ * Add a stall handler. `cb` is called in the monitor thread when a process
+ * started with ChildProcess::HEARTBEAT hasn't called Heartbeat::beat() for
+ * `timeout` (measured from the first time the monitor saw the process),
+ * and again after every further `timeout` as long as it doesn't.
+ * Detection granularity is the monitor interval.
+ */
+void ProcessMonitor::on_stall(std::chrono::milliseconds timeout,StallCallback cb) {
+    std::lock_guard<std::mutex> _(mutex_);
+    stalls_.push_back({ timeout, std::move(cb) });
+}
+
+/**
+ * Get the recent samples of a process.
+ *
+ * @returns the samples, oldest first; empty if the process isn't monitored.
+ */
+std::vector<ProcessMonitor::Sample> ProcessMonitor::series(pid_t pid) const {
+    std::lock_guard<std::mutex> _(mutex_);
+    const auto p = procs_.find(pid);
+    return p==procs_.end()
+        ? std::vector<Sample>()
+        : std::vector<Sample>(p->second.samples.begin(),p->second.samples.end());
+}
+
+/**
+ * Make a threshold callback that sends a signal to the process.
+ */
+ProcessMonitor::Callback ProcessMonitor::kill_process(int sig) {
+    return [sig](pid_t pid,const Sample&) {
+        ChildProcess::signal(pid,sig);
+    };
+}
+
+/**
+ * Make a stall callback that terminates the process: SIGTERM when the stall
+ * is first reported, SIGKILL when it's reported again.
+ */
+ProcessMonitor::StallCallback ProcessMonitor::terminate_process() {
+    return [](pid_t pid,unsigned count) {
+        ChildProcess::signal(pid,count==1 ? SIGTERM : SIGKILL);
+    };
+}
+
+/*
+ * Monitor thread.
+ */
+void ProcessMonitor::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(!stop_) {
+        lock.unlock();
+        check_beats();
+        sample();
+        lock.lock();
+        cv_.wait_for(lock,interval_,[this](){ return stop_; });
+    }
+}
+
+/*
+ * Take one sample of all running child processes.
+ */
+void ProcessMonitor::sample() {
+    const auto live = ChildProcess::live();
+
+    // Threshold crossings, reported after releasing the lock
+    std::vector<std::tuple<Callback,pid_t,Sample>> fire;
+
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+
+        // Forget processes that have been waited for
+        for(auto p=procs_.begin();p!=procs_.end();) {
+            if (std::find(live.begin(),live.end(),p->first)==live.end()) {
+                close(p->second);
+                p = procs_.erase(p);
+            } else {
+                ++p;
+            }
+        }
+
+        // Nothing to do with /proc data
+        if (history_==0 && thresholds_.empty()) {
+            for(auto& p : procs_) close(p.second);
+            procs_.clear();
+            return;
+        }
+
+        for(const auto pid : live) {
+            auto& p = procs_[pid];
+            if (p.stat<0 && !open(pid,p)) {
+                procs_.erase(pid);
+                continue;
+            }
+
+            // Read the /proc files; on failure, reopen in the next round
+            Sample s;
+            const auto first = p.last==std::chrono::steady_clock::time_point();
+            if (!read(p,s)) {
+                close(p);
+                procs_.erase(pid);
+                continue;
+            }
+            if (first) continue;
+
+            p.samples.push_back(s);
+            if (p.samples.size()>history_) p.samples.pop_front();
+
+            // Check the thresholds
+            p.above.resize(thresholds_.size());
+            for(size_t i=0;i<thresholds_.size();++i) {
+                const auto& t = thresholds_[i];
+                const auto value =
+                    t.metric==CPU        ? s.cpu :
+                    t.metric==RSS        ? double(s.rss) :
+                    t.metric==READ_RATE  ? s.read_rate :
+                                           s.write_rate;
+                const auto above = value>t.limit;
+                if (above && !p.above[i]) fire.emplace_back(t.cb,pid,s);
+                p.above[i] = above;
+            }
+        }
+    }
+
+    for(const auto& f : fire) {
+        std::get<0>(f)(std::get<1>(f),std::get<2>(f));
+    }
+}
+
+/*
+ * Check the heartbeats of all processes that have one.
+ */
+void ProcessMonitor::check_beats() {
+    auto counters = ChildProcess::heartbeats();
+    std::sort(counters.begin(),counters.end());
+    const auto now = std::chrono::steady_clock::now();
+
+    // Stalls, reported after releasing the lock
+    std::vector<std::tuple<StallCallback,pid_t,unsigned>> fire;
+
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+
+        // Forget processes that have been waited for
+        for(auto b=beats_.begin();b!=beats_.end();) {
+            const auto live = std::binary_search(counters.begin(),counters.end(),std::make_pair(b->first,0ULL),
+                [](const auto& x,const auto& y){ return x.first<y.first; });
+            b = live ? std::next(b) : beats_.erase(b);
+        }
+
+        for(const auto& c : counters) {
+            auto& b = beats_[c.first];
+            if (b.changed==std::chrono::steady_clock::time_point() || c.second!=b.value) {
+                b.value = c.second;
+                b.changed = now;
+                b.reported.assign(stalls_.size(),0);
+                continue;
+            }
+
+            b.reported.resize(stalls_.size());
+            for(size_t i=0;i<stalls_.size();++i) {
+                if (now-b.changed>=stalls_[i].timeout*(b.reported[i]+1)) {
+                    fire.emplace_back(stalls_[i].cb,c.first,++b.reported[i]);
+                }
+            }
+        }
+    }
+
+    for(const auto& f : fire) {
+        std::get<0>(f)(std::get<1>(f),std::get<2>(f));
+    }
+}
+
+/*
+ * Open the /proc files of a process.
+ */
+bool ProcessMonitor::open(pid_t pid,Proc& p) {
+    const auto dir = "/proc/" + std::to_string(pid) + "/";
+    p.stat  = ::open((dir + "stat").c_str(), O_RDONLY | O_CLOEXEC);
+    p.statm = ::open((dir + "statm").c_str(),O_RDONLY | O_CLOEXEC);
+    p.io    = ::open((dir + "io").c_str(),   O_RDONLY | O_CLOEXEC);  // May fail if not permitted
+    if (p.stat<0 || p.statm<0) {
+        close(p);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Close the /proc files of a process.
+ */
+void ProcessMonitor::close(Proc& p) {
+    for(auto fd : { &p.stat, &p.statm, &p.io }) {
+        if (*fd>=0) ::close(*fd);
+        *fd = -1;
+    }
+}
+
+/*
+ * Read the /proc files of a process and compute a sample from the
+ * difference to the previous one.
+ */
+bool ProcessMonitor::read(Proc& p,Sample& s) {
+    static const auto hz = double(sysconf(_SC_CLK_TCK));
+    static const auto pagesize = sysconf(_SC_PAGESIZE);
+
+    const auto prev = p.last;
+    s.time = std::chrono::steady_clock::now();
+    char buf[1024];
+
+    // CPU time: utime and stime are fields 14 and 15, counted from after the ")"
+    if (!reread(p.stat,buf,sizeof(buf))) return false;
+    const auto paren = strrchr(buf,')');
+    unsigned long long utime = 0, stime = 0;
+    if (!paren || sscanf(paren+2,"%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",&utime,&stime)!=2) {
+        return false;
+    }
+
+    // Resident memory: second field of statm
+    if (!reread(p.statm,buf,sizeof(buf))) return false;
+    long resident = 0;
+    sscanf(buf,"%*s %ld",&resident);
+    s.rss = resident*pagesize;
+
+    // I/O
+    unsigned long long rchar = 0, wchar = 0;
+    if (p.io>=0 && reread(p.io,buf,sizeof(buf))) {
+        rchar = io_value(buf,"rchar:");
+        wchar = io_value(buf,"wchar:");
+    }
+
+    // Rates since the previous sample
+    const auto secs = std::chrono::duration<double>(s.time-prev).count();
+    if (prev!=std::chrono::steady_clock::time_point() && secs>0) {
+        s.cpu        = (utime+stime-p.ticks)/hz/secs*100;
+        s.read_rate  = (rchar-p.rchar)/secs;
+        s.write_rate = (wchar-p.wchar)/secs;
+    }
+    p.last  = s.time;
+    p.ticks = utime+stime;
+    p.rchar = rchar;
+    p.wchar = wchar;
+    return true;
+}
@@ -0,0 +1,135 @@
+/**
+ * @brief Child process monitor header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/types.h>
+
+/**
+ * Live process monitor.
+ *
+ * Samples CPU usage, memory, and I/O of all running child processes
+ * (see ChildProcess::live) in a background thread at a fixed interval. The
+ * /proc files of each process are opened once and re-read with pread, so a
+ * sample costs three syscalls per process. Keeps a time series per process
+ * and calls threshold callbacks, e. g. to kill processes that use too much
+ * memory. Data of a process is dropped when it has been waited for.
+ *
+ * Also watches the heartbeat counters of processes started with
+ * ChildProcess::HEARTBEAT, all in one pass over shared memory, and reports
+ * processes that stopped beating. With a history of 0 and no thresholds,
+ * only the heartbeats are watched and /proc isn't read at all.
+ */
+class ProcessMonitor {
+public:
+    // One measurement of one process
+    struct Sample {
+        std::chrono::steady_clock::time_point time;
+        double cpu = 0;                 ///< CPU usage since previous sample (percent of one CPU)
+        long rss = 0;                   ///< Resident set size (bytes)
+        double read_rate = 0;           ///< Bytes read per second since previous sample (all I/O incl. pipes)
+        double write_rate = 0;          ///< Bytes written per second since previous sample (all I/O incl. pipes)
+    };
+
+    // What a threshold applies to
+    enum Metric { CPU, RSS, READ_RATE, WRITE_RATE };
+
+    // Threshold callback, invoked in the monitor thread
+    using Callback = std::function<void(pid_t,const Sample&)>;
+
+    // Stall callback, invoked in the monitor thread with the number of
+    // times the current stall has been reported (1, 2, ...)
+    using StallCallback = std::function<void(pid_t,unsigned)>;
+
+    // Ctor/dtor
+    explicit ProcessMonitor(
+        std::chrono::milliseconds interval=std::chrono::seconds(1),
+        size_t history=60
+    );
+    ~ProcessMonitor();
+
+    // No copying
+    ProcessMonitor(const ProcessMonitor&) = delete;
+    void operator=(const ProcessMonitor&) = delete;
+
+    // Call `cb` when a metric of a process rises above `limit`
+    void on_threshold(Metric metric,double limit,Callback cb);
+
+    // Call `cb` when a process hasn't beaten for `timeout`, and again
+    // after every further `timeout` until it beats again
+    void on_stall(std::chrono::milliseconds timeout,StallCallback cb);
+
+    // Recent samples of a process, oldest first
+    std::vector<Sample> series(pid_t pid) const;
+
+    // Callback that sends a signal to the process
+    static Callback kill_process(int sig=SIGKILL);
+
+    // Stall callback that terminates the process like the ChildProcess
+    // dtor: SIGTERM first, SIGKILL if it's still stalled
+    static StallCallback terminate_process();
+
+private:
+    // A monitored process
+    struct Proc {
+        int stat = -1, statm = -1, io = -1;   // Open /proc files
+        std::chrono::steady_clock::time_point last; // Time of previous read
+        unsigned long long ticks = 0;         // Previous utime+stime
+        unsigned long long rchar = 0, wchar = 0; // Previous I/O counters
+        std::deque<Sample> samples;
+        std::vector<bool> above;              // Per threshold: currently above limit
+    };
+
+    // A threshold
+    struct Threshold {
+        Metric metric;
+        double limit;
+        Callback cb;
+    };
+
+    // A stall handler
+    struct Stall {
+        std::chrono::milliseconds timeout;
+        StallCallback cb;
+    };
+
+    // Heartbeat of a process
+    struct Beat {
+        unsigned long long value = 0;           // Counter at the last change
+        std::chrono::steady_clock::time_point changed; // Time of the last change
+        std::vector<unsigned> reported;         // Per stall handler: times reported
+    };
+
+    const std::chrono::milliseconds interval_;
+    const size_t history_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::map<pid_t,Proc> procs_;
+    std::vector<Threshold> thresholds_;
+    std::vector<Stall> stalls_;
+    std::map<pid_t,Beat> beats_;
+    std::thread thread_;
+
+    void run();
+    void sample();
+    void check_beats();
+    static bool open(pid_t pid,Proc& p);
+    static void close(Proc& p);
+    static bool read(Proc& p,Sample& s);
+};
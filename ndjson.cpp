@@ -0,0 +1,229 @@
+/**
+ * @brief Streaming NDJSON reader implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <cstring>
+#include <stdexcept>
+
+#include "ndjson.hpp"
+#include "simd.hpp"
+
+/**
+ * Process the next chunk of the stream. Calls the record function for each
+ * record completed by this chunk, and for a final record without newline
+ * at the end of the stream.
+ */
+void NdjsonSplitter::operator()(std::string_view chunk) {
+    if (chunk.empty()) {
+        if (!carry_.empty()) emit(carry_);
+        carry_.clear();
+        return;
+    }
+
+    auto begin = chunk.data();
+    const auto end = begin + chunk.size();
+    for(const char* nl;(nl=find_byte(begin,end,'\n'))!=end;begin=nl+1) {
+        if (carry_.empty()) {
+            emit(std::string_view(begin,nl-begin));
+        } else {
+            carry_.append(begin,nl-begin);
+            emit(carry_);
+            carry_.clear();
+        }
+    }
+    carry_.append(begin,end-begin);
+}
+
+/*
+ * Pass a record on, unless it's blank.
+ */
+void NdjsonSplitter::emit(std::string_view record) {
+    if (!record.empty() && record.back()=='\r') record.remove_suffix(1);
+    if (record.find_first_not_of(" \t")==std::string_view::npos) return;
+    fct_(record);
+}
+
+/**
+ * Get the next token.
+ *
+ * @returns the token, or END at the end of the text.
+ *
+ * @throws std::exception if the text isn't valid JSON.
+ */
+JsonTokenizer::Token JsonTokenizer::next() {
+    // Skip white space and separators
+    while(pos_<json_.size() && std::strchr(" \t\r\n,:",json_[pos_]) && json_[pos_]) ++pos_;
+    if (pos_==json_.size()) {
+        if (!nesting_.empty()) fail("Unexpected end");
+        return { END, {} };
+    }
+
+    const auto start = pos_;
+    const auto c = json_[pos_++];
+    switch(c) {
+        case '{':
+        case '[':
+            nesting_ += c;
+            key_ = c=='{';
+            return { c=='{' ? BEGIN_OBJECT : BEGIN_ARRAY, json_.substr(start,1) };
+
+        case '}':
+        case ']':
+            if (nesting_.empty() || nesting_.back()!=(c=='}' ? '{' : '[')) fail("Unexpected " + std::string(1,c));
+            nesting_.pop_back();
+            value_done();
+            return { c=='}' ? END_OBJECT : END_ARRAY, json_.substr(start,1) };
+
+        case '"': {
+            // Find the closing quote, i. e. one not preceded by an odd number of backslashes
+            const auto end = json_.data() + json_.size();
+            for(auto p=json_.data()+pos_;;++p) {
+                p = find_byte(p,end,'"');
+                if (p==end) fail("Unterminated string");
+                auto bs = 0;
+                while(p-bs>json_.data()+pos_ && p[-bs-1]=='\\') ++bs;
+                if (bs%2==0) {
+                    const auto text = json_.substr(pos_,p-(json_.data()+pos_));
+                    pos_ = p - json_.data() + 1;
+                    const auto type = key_ ? KEY : STRING;
+                    if (key_) key_ = false; else value_done();
+                    return { type, text };
+                }
+            }
+        }
+
+        default:
+            if (c=='-' || (c>='0' && c<='9')) {
+                while(pos_<json_.size() && std::strchr("0123456789+-.eE",json_[pos_]) && json_[pos_]) ++pos_;
+                value_done();
+                return { NUMBER, json_.substr(start,pos_-start) };
+            }
+            for(const auto& lit : { std::pair<const char*,Type>{ "true", TRUE }, { "false", FALSE }, { "null", NUL } }) {
+                const auto len = std::strlen(lit.first);
+                if (json_.compare(start,len,lit.first)==0) {
+                    pos_ = start + len;
+                    value_done();
+                    return { lit.second, json_.substr(start,len) };
+                }
+            }
+            fail("Unexpected character");
+    }
+}
+
+/**
+ * Get a top-level member of an object without parsing the rest.
+ *
+ * @returns the value as raw JSON text; strings without the quotes and with
+ *          escapes intact, objects and arrays including their brackets.
+ *
+ * @throws std::exception if the text isn't valid JSON.
+ */
+std::optional<std::string_view> JsonTokenizer::member(std::string_view object,std::string_view key) {
+    JsonTokenizer tok(object);
+    if (tok.next().type!=BEGIN_OBJECT) return std::nullopt;
+    for(;;) {
+        auto t = tok.next();
+        if (t.type==END_OBJECT || t.type==END) return std::nullopt;
+        const auto found = t.type==KEY && t.text==key;
+
+        // Get the value, skipping nested objects and arrays
+        t = tok.next();
+        const auto begin = t.text.data();
+        if (t.type==BEGIN_OBJECT || t.type==BEGIN_ARRAY) {
+            const auto depth = tok.nesting_.size();
+            while(tok.nesting_.size()>=depth) t = tok.next();
+        }
+        if (found) return std::string_view(begin,t.text.data()+t.text.size()-begin);
+    }
+}
+
+/**
+ * Resolve the escape sequences of a string token. \u escapes are converted
+ * to UTF-8 (including surrogate pairs).
+ *
+ * @throws std::exception on an invalid escape sequence: \u not followed by
+ *         exactly four hex digits, or a surrogate that isn't part of a pair.
+ */
+std::string JsonTokenizer::unescape(std::string_view text) {
+    std::string ret;
+    ret.reserve(text.size());
+    const auto hex = [&text](size_t pos) {
+        if (pos+4>text.size()) throw std::runtime_error("Invalid \\u escape");
+        unsigned value = 0;
+        for(auto c : text.substr(pos,4)) {
+            const auto d =
+                c>='0' && c<='9' ? c-'0' :
+                c>='a' && c<='f' ? c-'a'+10 :
+                c>='A' && c<='F' ? c-'A'+10 : -1;
+            if (d<0) throw std::runtime_error("Invalid \\u escape");
+            value = value<<4 | d;
+        }
+        return value;
+    };
+    for(size_t i=0;i<text.size();++i) {
+        if (text[i]!='\\') {
+            ret += text[i];
+            continue;
+        }
+        if (++i==text.size()) throw std::runtime_error("Invalid escape");
+        switch(text[i]) {
+            case '"':  ret += '"';  break;
+            case '\\': ret += '\\'; break;
+            case '/':  ret += '/';  break;
+            case 'b':  ret += '\b'; break;
+            case 'f':  ret += '\f'; break;
+            case 'n':  ret += '\n'; break;
+            case 'r':  ret += '\r'; break;
+            case 't':  ret += '\t'; break;
+            case 'u': {
+                auto cp = hex(i+1);
+                i += 4;
+                if (cp>=0xdc00 && cp<0xe000) throw std::runtime_error("Unpaired low surrogate");
+                if (cp>=0xd800 && cp<0xdc00) {
+                    if (text.compare(i+1,2,"\\u")!=0) throw std::runtime_error("Unpaired high surrogate");
+                    const auto low = hex(i+3);
+                    if (low<0xdc00 || low>=0xe000) throw std::runtime_error("Invalid low surrogate");
+                    cp = 0x10000 + ((cp-0xd800)<<10) + (low-0xdc00);
+                    i += 6;
+                }
+                if (cp<0x80) {
+                    ret += static_cast<char>(cp);
+                } else if (cp<0x800) {
+                    ret += static_cast<char>(0xc0 | cp>>6);
+                    ret += static_cast<char>(0x80 | (cp & 0x3f));
+                } else if (cp<0x10000) {
+                    ret += static_cast<char>(0xe0 | cp>>12);
+                    ret += static_cast<char>(0x80 | (cp>>6 & 0x3f));
+                    ret += static_cast<char>(0x80 | (cp & 0x3f));
+                } else {
+                    ret += static_cast<char>(0xf0 | cp>>18);
+                    ret += static_cast<char>(0x80 | (cp>>12 & 0x3f));
+                    ret += static_cast<char>(0x80 | (cp>>6 & 0x3f));
+                    ret += static_cast<char>(0x80 | (cp & 0x3f));
+                }
+                break;
+            }
+            default:
+                throw std::runtime_error("Invalid escape \\" + std::string(1,text[i]));
+        }
+    }
+    return ret;
+}
+
+/*
+ * Throw an exception for invalid JSON.
+ */
+void JsonTokenizer::fail(const std::string& what) const {
+    throw std::runtime_error("Invalid JSON at offset " + std::to_string(pos_) + ": " + what);
+}
+
+/*
+ * A value is complete; in an object, a member name follows.
+ */
+void JsonTokenizer::value_done() {
+    key_ = !nesting_.empty() && nesting_.back()=='{';
+}
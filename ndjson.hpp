@@ -0,0 +1,83 @@
+/**
+ * @brief Streaming NDJSON reader header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+/**
+ * Splits a stream of newline-delimited JSON into records while it's read,
+ * for ChildProcess::read_stdout:
+ *
+ *      auto out = chld.read_stdout(NdjsonSplitter([](std::string_view record) {
+ *          const auto id = JsonTokenizer::member(record,"id");
+ *          ...
+ *      }));
+ *
+ * Records that are complete within a chunk are passed as views into the
+ * read buffer; only records that span chunks are copied, once. Blank lines
+ * are skipped; a carriage return before the newline is removed. The record
+ * view is valid only during the callback.
+ */
+class NdjsonSplitter {
+public:
+    using Record = std::function<void(std::string_view)>;
+
+    explicit NdjsonSplitter(Record fct) : fct_(std::move(fct)) {}
+
+    // Process the next chunk; an empty chunk means end of stream
+    void operator()(std::string_view chunk);
+
+private:
+    Record fct_;
+    std::string carry_;                     // Incomplete record from previous chunks
+
+    void emit(std::string_view record);
+};
+
+/**
+ * Minimal JSON tokenizer, working on a view without copying.
+ *
+ * Returns the tokens of a JSON text one by one. Strings are returned
+ * without the quotes and with escapes intact (see unescape); object
+ * member names are returned as KEY. Checks brackets and the syntax of
+ * individual tokens but not the complete grammar.
+ */
+class JsonTokenizer {
+public:
+    enum Type { END, BEGIN_OBJECT, END_OBJECT, BEGIN_ARRAY, END_ARRAY, KEY, STRING, NUMBER, TRUE, FALSE, NUL };
+
+    struct Token {
+        Type type;
+        std::string_view text;
+    };
+
+    explicit JsonTokenizer(std::string_view json) : json_(json) {}
+
+    // Get the next token; throws on invalid JSON
+    Token next();
+
+    // Get a top-level member of an object, as raw JSON text (strings
+    // without quotes), or nothing if there is no such member
+    static std::optional<std::string_view> member(std::string_view object,std::string_view key);
+
+    // Resolve the escape sequences of a string token
+    static std::string unescape(std::string_view text);
+
+private:
+    std::string_view json_;
+    size_t pos_ = 0;
+    std::string nesting_;                   // '{' or '[' per level
+    bool key_ = false;                      // Next string is a member name
+
+    [[noreturn]] void fail(const std::string& what) const;
+    void value_done();
+};
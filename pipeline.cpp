@@ -0,0 +1,384 @@
+/**
+ * @brief Shell-free command line implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pipeline.hpp"
+
+namespace {
+
+// Token of a command line
+struct Token {
+    enum Kind { WORD, PIPE, REDIR } kind = WORD;
+    std::string text;                   // WORD: the word, REDIR: the operator
+    size_t quoted = std::string::npos;  // WORD: length of text before the first quote
+    int fd = -1;                        // REDIR: file descriptor to redirect
+};
+
+/*
+ * Throw a syntax error exception.
+ */
+[[noreturn]] void syntax(const std::string& what,const std::string& cmdline) {
+    throw std::runtime_error("Pipeline: " + what + " in command line: " + cmdline);
+}
+
+/*
+ * Convert a string of digits to a file descriptor number.
+ */
+int fd_number(const std::string& digits,const std::string& cmdline) {
+    errno = 0;
+    const auto fd = std::strtol(digits.c_str(),nullptr,10);
+    if (errno==ERANGE || fd>INT_MAX) syntax("File descriptor " + digits + " out of range",cmdline);
+    return static_cast<int>(fd);
+}
+
+/*
+ * Check if a word is an environment assignment (NAME=value, with NAME
+ * unquoted and a valid identifier).
+ */
+bool is_assignment(const Token& t) {
+    const auto eq = t.text.find('=');
+    if (eq==std::string::npos || eq==0 || eq>=t.quoted) return false;
+    if (isdigit(static_cast<unsigned char>(t.text[0]))) return false;
+    for(size_t i=0;i<eq;++i) {
+        const auto c = static_cast<unsigned char>(t.text[i]);
+        if (!isalnum(c) && c!='_') return false;
+    }
+    return true;
+}
+
+/*
+ * Check if the { at s[pos] starts a brace expansion: a closing } in the
+ * same word, with a , or .. before it (e. g. {a,b} or {1..3}). A lone {}
+ * as used by find and xargs is taken literally, as by the shell.
+ */
+bool is_brace_expansion(const std::string& s,size_t pos) {
+    const auto end = s.find_first_of(" \t\n|<>}",pos+1);
+    if (end==std::string::npos || s[end]!='}') return false;
+    const auto inner = s.substr(pos+1,end-pos-1);
+    return inner.find(',')!=std::string::npos || inner.find("..")!=std::string::npos;
+}
+
+/*
+ * Split a command line into tokens.
+ */
+std::vector<Token> tokenize(const std::string& s) {
+    std::vector<Token> ret;
+    size_t i = 0;
+
+    while(i<s.size()) {
+        const auto c = s[i];
+
+        // Skip white space
+        if (c==' ' || c=='\t') {
+            ++i;
+            continue;
+        }
+
+        // A newline separates commands like ;
+        if (c=='\n') syntax("Newline not supported",s);
+
+        // Pipe
+        if (c=='|') {
+            if (i+1<s.size() && s[i+1]=='|') syntax("|| not supported",s);
+            ret.push_back({Token::PIPE,"|"});
+            ++i;
+            continue;
+        }
+
+        // Redirection, with optional leading fd number
+        auto j = i;
+        while(j<s.size() && isdigit(static_cast<unsigned char>(s[j]))) ++j;
+        if (j<s.size() && (s[j]=='<' || s[j]=='>')) {
+            Token t;
+            t.kind = Token::REDIR;
+            t.fd = j>i ? fd_number(s.substr(i,j-i),s) : s[j]=='<' ? 0 : 1;
+            t.text = s[j++];
+            if (j<s.size() && (s[j]=='>' || s[j]=='&') && t.text==">") t.text += s[j++];
+            else if (j<s.size() && s[j]=='&' && t.text=="<") t.text += s[j++];
+            ret.push_back(t);
+            i = j;
+            continue;
+        }
+
+        // Word
+        Token t;
+        const auto start = i;
+        while(i<s.size()) {
+            const auto w = s[i];
+            if (w==' ' || w=='\t' || w=='\n' || w=='|' || w=='<' || w=='>') break;
+
+            const auto mark = [&](){ if (t.quoted==std::string::npos) t.quoted = t.text.size(); };
+
+            if (w=='\'') {
+                mark();
+                const auto end = s.find('\'',i+1);
+                if (end==std::string::npos) syntax("Unterminated '",s);
+                t.text += s.substr(i+1,end-i-1);
+                i = end+1;
+            } else if (w=='"') {
+                mark();
+                for(++i;;++i) {
+                    if (i>=s.size()) syntax("Unterminated \"",s);
+                    if (s[i]=='"') break;
+                    if (s[i]=='$' || s[i]=='`') syntax(std::string(1,s[i]) + " not supported",s);
+                    if (s[i]=='\\' && i+1<s.size() && strchr("$`\"\\\n",s[i+1])) {
+                        if (s[++i]=='\n') continue;
+                    }
+                    t.text += s[i];
+                }
+                ++i;
+            } else if (w=='\\') {
+                mark();
+                if (++i>=s.size()) syntax("Trailing \\",s);
+                if (s[i]!='\n') t.text += s[i];
+                ++i;
+            } else if (strchr("$`;&()*?[",w) || ((w=='#' || w=='~') && i==start)) {
+                syntax(std::string(1,w) + " not supported",s);
+            } else if (w=='~' && (s[i-1]=='=' || s[i-1]==':') && is_assignment(t)) {
+                // Tilde after the = or a : of an assignment, e. g. PATH=~/bin
+                syntax("~ not supported",s);
+            } else if (w=='{' && is_brace_expansion(s,i)) {
+                syntax("{ not supported",s);
+            } else {
+                t.text += w;
+                ++i;
+            }
+        }
+        ret.push_back(t);
+    }
+
+    return ret;
+}
+
+} // namespace
+
+/**
+ * Parse a command line into a list of commands without running them.
+ *
+ * @param cmdline The command line, e. g. `LC_ALL=C sort <in | uniq -c >out 2>&1`.
+ *
+ * @returns the commands of the pipeline, in order.
+ *
+ * @throws std::exception if the command line is empty, malformed, or uses
+ * shell features that aren't supported.
+ */
+std::vector<Pipeline::Command> Pipeline::parse(const std::string& cmdline) {
+    const auto tokens = tokenize(cmdline);
+    std::vector<Command> ret(1);
+
+    for(size_t i=0;i<tokens.size();++i) {
+        const auto& t = tokens[i];
+        auto& cmd = ret.back();
+
+        switch(t.kind) {
+            case Token::PIPE: {
+                if (cmd.argv.empty()) syntax("Empty command",cmdline);
+                ret.emplace_back();
+                break;
+            }
+
+            case Token::REDIR: {
+                if (i+1>=tokens.size() || tokens[i+1].kind!=Token::WORD) {
+                    syntax("Missing target of " + t.text,cmdline);
+                }
+                const auto& target = tokens[++i].text;
+
+                Redirect r;
+                r.fd = t.fd;
+                if (t.text==">&" || t.text=="<&") {
+                    if (target.empty() || target.find_first_not_of("0123456789")!=std::string::npos) {
+                        syntax("Bad file descriptor " + target,cmdline);
+                    }
+                    r.dupfd = fd_number(target,cmdline);
+                } else {
+                    r.file = target;
+                    r.oflags =
+                        t.text=="<"  ? O_RDONLY :
+                        t.text==">>" ? O_WRONLY | O_CREAT | O_APPEND :
+                                       O_WRONLY | O_CREAT | O_TRUNC;
+                }
+                cmd.redirects.push_back(r);
+                break;
+            }
+
+            case Token::WORD: {
+                if (cmd.argv.empty() && is_assignment(t)) {
+                    const auto eq = t.text.find('=');
+                    cmd.env.emplace_back(t.text.substr(0,eq),t.text.substr(eq+1));
+                } else {
+                    cmd.argv.push_back(t.text);
+                }
+                break;
+            }
+        }
+    }
+
+    if (ret.back().argv.empty()) syntax("Empty command",cmdline);
+    return ret;
+}
+
+/**
+ * Find a program in the directories listed in $PATH.
+ *
+ * @param name Program name. Returned unchanged if it contains a slash.
+ *
+ * @returns the full path name of the program.
+ *
+ * @throws std::exception if the program isn't found.
+ */
+std::string Pipeline::which(const std::string& name) {
+    if (name.find('/')!=std::string::npos) return name;
+
+    const auto path = getenv("PATH");
+    std::string dirs = path ? path : "/usr/bin:/bin";
+    for(size_t pos=0;pos<=dirs.size();) {
+        auto end = dirs.find(':',pos);
+        if (end==std::string::npos) end = dirs.size();
+        const auto dir = end>pos ? dirs.substr(pos,end-pos) : ".";
+        const auto exe = dir + "/" + name;
+
+        struct stat st;
+        if (stat(exe.c_str(),&st)==0 && S_ISREG(st.st_mode) && access(exe.c_str(),X_OK)==0) {
+            return exe;
+        }
+        pos = end+1;
+    }
+
+    throw std::runtime_error("Command not found: " + name);
+}
+
+/**
+ * Run a command line.
+ *
+ * The commands run in the background, connected with pipes. Redirections
+ * and environment assignments are performed in the child processes before
+ * the programs are executed.
+ *
+ * @param cmdline Command line (see class description for the syntax).
+ * @param flags ChildProcess flags. IN applies to the first command, OUT and
+ *              ERR to the last one, everything else to all commands.
+ *
+ * @throws std::exception if the command line can't be parsed, a program
+ * isn't found, or a process can't be started. Errors opening redirected
+ * files are reported by the affected child process on its stderr, just
+ * like a shell would do.
+ */
+Pipeline::Pipeline(const std::string& cmdline,int flags) {
+    const auto cmds = parse(cmdline);
+
+    // Find all programs before starting anything
+    std::vector<std::string> exes;
+    for(const auto& cmd : cmds) {
+        exes.push_back(which(cmd.argv.front()));
+    }
+
+    procs_.reserve(cmds.size());
+    int prev = -1;                      // Read end of the pipe from the previous command
+    try {
+        for(size_t i=0;i<cmds.size();++i) {
+            const auto first = i==0;
+            const auto last  = i+1==cmds.size();
+
+            // Make the pipe to the next command
+            int next[2] = { -1, -1 };
+            if (!last && pipe2(next,O_CLOEXEC)) {
+                const auto err = errno;
+                throw std::runtime_error("Error " + std::to_string(err) + " creating the pipe");
+            }
+
+            auto f = flags & ~(ChildProcess::IN | ChildProcess::OUT | ChildProcess::ERR);
+            if (first) f |= flags & ChildProcess::IN;
+            if (last)  f |= flags & (ChildProcess::OUT | ChildProcess::ERR);
+
+            const auto& cmd = cmds[i];
+            try {
+                procs_.emplace_back(
+                    exes[i],
+                    std::vector<std::string>(cmd.argv.begin()+1,cmd.argv.end()),
+                    f,
+                    [cmd,in=prev,out=next[1]](){
+                        if (in>=0)  { dup2(in, STDIN_FILENO);  }
+                        if (out>=0) { dup2(out,STDOUT_FILENO); }
+
+                        for(const auto& e : cmd.env) {
+                            setenv(e.first.c_str(),e.second.c_str(),1);
+                        }
+
+                        for(const auto& r : cmd.redirects) {
+                            auto fd = r.dupfd;
+                            if (fd<0) {
+                                fd = open(r.file.c_str(),r.oflags,0666);
+                                if (fd<0) {
+                                    const auto err = errno;
+                                    throw std::runtime_error(r.file + ": " + strerror(err));
+                                }
+                            }
+                            if (fd!=r.fd && dup2(fd,r.fd)<0) {
+                                const auto err = errno;
+                                throw std::runtime_error("Redirecting fd " + std::to_string(r.fd) + ": " + strerror(err));
+                            }
+                            if (r.dupfd<0 && fd!=r.fd) close(fd);
+                        }
+                    }
+                );
+            } catch(...) {
+                if (!last) { close(next[0]); close(next[1]); }
+                throw;
+            }
+
+            // The pipe ends now belong to the child processes
+            if (prev>=0) close(prev);
+            if (!last) close(next[1]);
+            prev = next[0];
+        }
+    } catch(...) {
+        if (prev>=0) close(prev);
+        throw;
+    }
+}
+
+/**
+ * Wait for all processes of the pipeline to terminate.
+ *
+ * @returns the exit status of the last command (-1 if not available).
+ */
+int Pipeline::join() {
+    auto ret = -1;
+    for(auto& p : procs_) {
+        ret = p.join();
+    }
+    return ret;
+}
+
+/**
+ * Write into the standard input of the first command (requires IN).
+ */
+std::future<void> Pipeline::make_stdin(std::function<void(std::ostream&)> fct) {
+    return procs_.front().make_stdin(fct);
+}
+
+/**
+ * Read from the standard output of the last command (requires OUT).
+ */
+std::future<void> Pipeline::get_stdout(std::function<void(std::istream&)> fct) {
+    return procs_.back().get_stdout(fct);
+}
+
+/**
+ * Read from the standard error output of the last command (requires ERR).
+ */
+std::future<void> Pipeline::get_stderr(std::function<void(std::istream&)> fct) {
+    return procs_.back().get_stderr(fct);
+}
@@ -0,0 +1,70 @@
+/**
+ * @brief Shell-free command line header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "childprocess.hpp"
+
+/**
+ * Shell-free command line.
+ *
+ * Runs a command line written in a safe subset of shell syntax as one or
+ * more ChildProcess objects connected with pipes, without executing
+ * /bin/sh. Supported are:
+ *
+ * - Words with '...' and "..." quoting and backslash escapes
+ * - Leading NAME=value environment assignments
+ * - Redirections: <file, >file, >>file, 2>file, 2>>file, 2>&1 (any fd numbers)
+ * - Pipes: cmd1 | cmd2 | ...
+ *
+ * Everything else that a shell would interpret (variables, globbing, brace
+ * and tilde expansion, command substitution, ;, unquoted newlines, &&, ||,
+ * &, subshells, comments) is rejected with an exception instead of being
+ * passed on literally, as are fd numbers that don't fit into an int.
+ */
+class Pipeline {
+public:
+    // A redirection: either open `file` with `oflags`, or duplicate `dupfd`
+    struct Redirect {
+        int fd = -1;                    ///< File descriptor to redirect
+        std::string file;               ///< File to open (empty if dupfd is used)
+        int oflags = 0;                 ///< Flags for open(2)
+        int dupfd = -1;                 ///< File descriptor to duplicate (-1 if file is used)
+    };
+
+    // One command of the pipeline
+    struct Command {
+        std::vector<std::string> argv;  ///< Program name and arguments
+        std::vector<std::pair<std::string,std::string>> env; ///< Environment assignments
+        std::vector<Redirect> redirects;///< Redirections, in command line order
+    };
+
+    // Parse a command line without running it
+    static std::vector<Command> parse(const std::string& cmdline);
+
+    // Find a program like the shell does, using $PATH
+    static std::string which(const std::string& name);
+
+    // Ctor
+    explicit Pipeline(const std::string& cmdline,int flags=0);
+
+    // Wait for all processes to terminate
+    int join();
+
+    // Piping (into the first/from the last command)
+    std::future<void> make_stdin(std::function<void(std::ostream&)>);
+    std::future<void> get_stdout(std::function<void(std::istream&)>);
+    std::future<void> get_stderr(std::function<void(std::istream&)>);
+
+private:
+    std::vector<ChildProcess> procs_;   // One process per command
+};
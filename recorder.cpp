@@ -0,0 +1,321 @@
+/**
+ * @brief Child process session recording and replay implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <algorithm>
+#include <streambuf>
+#include <thread>
+
+#include "childprocess.hpp"
+#include "recorder.hpp"
+
+namespace {
+
+const char magic[] = "CPTRACE1";
+
+/*
+ * Write an unsigned number as varint (7 bits per byte, low bits first).
+ */
+void put_varint(std::ostream& os,unsigned long long value) {
+    while(value>=0x80) {
+        os.put(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    os.put(static_cast<char>(value));
+}
+
+/*
+ * Read a varint.
+ */
+bool get_varint(std::istream& is,unsigned long long& value) {
+    value = 0;
+    for(auto shift=0;shift<64;shift+=7) {
+        const auto c = is.get();
+        if (c==EOF) return false;
+        value |= static_cast<unsigned long long>(c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+/*
+ * Output stream buffer that records what's written before passing it on.
+ */
+class TeeOut : public std::streambuf {
+public:
+    TeeOut(std::ostream& os,SessionRecorder& rec) : os_(os), rec_(rec) {
+        setp(buf_,buf_+sizeof(buf_));
+    }
+
+    ~TeeOut() {
+        pass();
+    }
+
+protected:
+    int overflow(int c) override {
+        if (!pass()) return traits_type::eof();
+        if (c!=traits_type::eof()) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+        return pass() && os_.flush() ? 0 : -1;
+    }
+
+private:
+    std::ostream& os_;
+    SessionRecorder& rec_;
+    char buf_[4096];
+
+    // Record and pass on the buffered data
+    bool pass() {
+        const auto n = pptr()-pbase();
+        if (n>0) {
+            rec_.record(SessionTrace::STDIN,pbase(),n);
+            os_.write(pbase(),n);
+            setp(buf_,buf_+sizeof(buf_));
+        }
+        return !!os_;
+    }
+};
+
+/*
+ * Input stream buffer that records what's read. Takes whatever the source
+ * has available, so chunks and timestamps match what the process wrote.
+ */
+class TeeIn : public std::streambuf {
+public:
+    TeeIn(std::istream& is,SessionRecorder& rec,int stream) : is_(is), rec_(rec), stream_(stream) {}
+
+protected:
+    int underflow() override {
+        const auto src = is_.rdbuf();
+        if (src->sgetc()==traits_type::eof()) return traits_type::eof();
+
+        const auto avail = std::min<std::streamsize>(std::max<std::streamsize>(src->in_avail(),1),sizeof(buf_));
+        const auto n = src->sgetn(buf_,avail);
+        if (n<=0) return traits_type::eof();
+
+        rec_.record(stream_,buf_,n);
+        setg(buf_,buf_,buf_+n);
+        return traits_type::to_int_type(buf_[0]);
+    }
+
+private:
+    std::istream& is_;
+    SessionRecorder& rec_;
+    int stream_;
+    char buf_[4096];
+};
+
+/*
+ * Read everything from a stream, counting bytes and noting when the first arrived.
+ */
+void drain(std::istream& is,unsigned long long& bytes,double& first,std::chrono::steady_clock::time_point start) {
+    const auto src = is.rdbuf();
+    char buf[4096];
+    while(src->sgetc()!=std::char_traits<char>::eof()) {
+        if (first<0) first = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        const auto n = src->sgetn(buf,std::min<std::streamsize>(std::max<std::streamsize>(src->in_avail(),1),sizeof(buf)));
+        bytes += n;
+    }
+}
+
+} // namespace
+
+/**
+ * Start recording a session.
+ *
+ * @param path Name of the trace file to create.
+ *
+ * @throws std::exception if the file can't be created.
+ */
+SessionRecorder::SessionRecorder(const std::string& path)
+: ofs_(path,std::ios::binary)
+, last_(std::chrono::steady_clock::now()) {
+    if (!ofs_) {
+        throw std::runtime_error("Can't create " + path);
+    }
+    ofs_.write(magic,sizeof(magic)-1);
+}
+
+/**
+ * Wrap a function passed to make_stdin so that what it writes is recorded.
+ */
+std::function<void(std::ostream&)> SessionRecorder::record_stdin(std::function<void(std::ostream&)> fct) {
+    return [this,fct](std::ostream& os) {
+        TeeOut buf(os,*this);
+        std::ostream tee(&buf);
+        fct(tee);
+        tee.flush();
+    };
+}
+
+/**
+ * Wrap a function passed to get_stdout so that what it reads is recorded.
+ */
+std::function<void(std::istream&)> SessionRecorder::record_stdout(std::function<void(std::istream&)> fct) {
+    return [this,fct](std::istream& is) {
+        TeeIn buf(is,*this,SessionTrace::STDOUT);
+        std::istream tee(&buf);
+        fct(tee);
+    };
+}
+
+/**
+ * Wrap a function passed to get_stderr so that what it reads is recorded.
+ */
+std::function<void(std::istream&)> SessionRecorder::record_stderr(std::function<void(std::istream&)> fct) {
+    return [this,fct](std::istream& is) {
+        TeeIn buf(is,*this,SessionTrace::STDERR);
+        std::istream tee(&buf);
+        fct(tee);
+    };
+}
+
+/**
+ * Record a chunk of data. Thread-safe.
+ */
+void SessionRecorder::record(int stream,const char* data,size_t size) {
+    std::lock_guard<std::mutex> _(mutex_);
+    const auto now = std::chrono::steady_clock::now();
+    ofs_.put(static_cast<char>(stream));
+    put_varint(ofs_,std::chrono::duration_cast<std::chrono::microseconds>(now-last_).count());
+    put_varint(ofs_,size);
+    ofs_.write(data,size);
+    last_ = now;
+}
+
+/**
+ * Record the exit status and close the trace file. Call after all pipe
+ * functions have finished.
+ *
+ * @throws std::exception if the trace file can't be written.
+ */
+void SessionRecorder::finish(int status) {
+    std::lock_guard<std::mutex> _(mutex_);
+    const auto now = std::chrono::steady_clock::now();
+    ofs_.put(SessionTrace::EXIT);
+    put_varint(ofs_,std::chrono::duration_cast<std::chrono::microseconds>(now-last_).count());
+    put_varint(ofs_,static_cast<unsigned>(status));
+    ofs_.close();
+    if (!ofs_) {
+        throw std::runtime_error("Error writing the trace file");
+    }
+}
+
+/**
+ * Load a trace file written by SessionRecorder.
+ *
+ * @throws std::exception if the file can't be read or is malformed.
+ */
+SessionTrace SessionTrace::load(const std::string& path) {
+    std::ifstream ifs(path,std::ios::binary);
+    char head[sizeof(magic)-1];
+    if (!ifs.read(head,sizeof(head)) || !std::equal(head,head+sizeof(head),magic)) {
+        throw std::runtime_error("Not a trace file: " + path);
+    }
+
+    // Data lengths are checked against the file size before allocating
+    ifs.seekg(0,std::ios::end);
+    const auto size = static_cast<unsigned long long>(ifs.tellg());
+    ifs.seekg(sizeof(head));
+
+    SessionTrace ret;
+    auto time = std::chrono::microseconds(0);
+    for(int type;(type=ifs.get())!=EOF;) {
+        unsigned long long delta, value;
+        if (type>EXIT || !get_varint(ifs,delta) || !get_varint(ifs,value)) {
+            throw std::runtime_error("Malformed trace file: " + path);
+        }
+        time += std::chrono::microseconds(delta);
+
+        Record r;
+        r.stream = static_cast<Stream>(type);
+        r.time = time;
+        if (r.stream==EXIT) {
+            r.status = static_cast<int>(value);
+        } else {
+            if (value>size-static_cast<unsigned long long>(ifs.tellg())) {
+                throw std::runtime_error("Truncated trace file: " + path);
+            }
+            r.data.resize(value);
+            if (!ifs.read(&r.data[0],value)) {
+                throw std::runtime_error("Truncated trace file: " + path);
+            }
+        }
+        ret.records_.push_back(std::move(r));
+    }
+    return ret;
+}
+
+/**
+ * Get the measurements of the recorded session.
+ */
+SessionTrace::Stats SessionTrace::stats() const {
+    Stats ret;
+    for(const auto& r : records_) {
+        const auto t = std::chrono::duration<double>(r.time).count();
+        switch(r.stream) {
+            case STDIN:  ret.in_bytes += r.data.size(); break;
+            case STDOUT: ret.out_bytes += r.data.size(); if (ret.first_output<0) ret.first_output = t; break;
+            case STDERR: ret.err_bytes += r.data.size(); break;
+            case EXIT:   ret.status = r.status; ret.seconds = t; break;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Replay the recorded input to a program and measure its output.
+ *
+ * @param exe Program to run (see ChildProcess).
+ * @param args Its command line arguments.
+ * @param realtime Feed the input with the original timing if true,
+ *                 or as fast as possible if false.
+ *
+ * @returns the measurements of the original and the replayed session, and
+ * how much the replay differs.
+ */
+SessionTrace::Report SessionTrace::replay(const std::string& exe,const std::vector<std::string>& args,bool realtime) const {
+    Report ret;
+    ret.original = stats();
+    auto& rep = ret.replay;
+
+    ChildProcess chld(exe,args,ChildProcess::IN | ChildProcess::OUT | ChildProcess::ERR);
+    const auto start = std::chrono::steady_clock::now();
+
+    auto in = chld.make_stdin([&](std::ostream& os) {
+        for(const auto& r : records_) {
+            if (r.stream!=STDIN) continue;
+            if (realtime) std::this_thread::sleep_until(start+r.time);
+            os.write(r.data.data(),r.data.size());
+            if (realtime) os.flush();
+            if (!os) break;
+            rep.in_bytes += r.data.size();
+        }
+    });
+    double first_err = -1;
+    auto out = chld.get_stdout([&](std::istream& is){ drain(is,rep.out_bytes,rep.first_output,start); });
+    auto err = chld.get_stderr([&](std::istream& is){ drain(is,rep.err_bytes,first_err,start); });
+
+    in.get();
+    out.get();
+    err.get();
+    rep.status = chld.join();
+    rep.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+    ret.seconds_delta = rep.seconds - ret.original.seconds;
+    ret.throughput_delta = rep.throughput() - ret.original.throughput();
+    if (rep.first_output>=0 && ret.original.first_output>=0) {
+        ret.first_output_delta = rep.first_output - ret.original.first_output;
+    }
+    return ret;
+}
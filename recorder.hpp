@@ -0,0 +1,108 @@
+/**
+ * @brief Child process session recording and replay header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Session recorder.
+ *
+ * Records what goes into and comes out of a ChildProcess as timestamped
+ * chunks, plus its exit status, in a compact binary trace file. Use it by
+ * wrapping the functions passed to make_stdin, get_stdout, and get_stderr:
+ *
+ *      SessionRecorder rec("session.trace");
+ *      auto in  = chld.make_stdin(rec.record_stdin(writer));
+ *      auto out = chld.get_stdout(rec.record_stdout(reader));
+ *      ...
+ *      rec.finish(chld.join());
+ *
+ * Trace format: the magic "CPTRACE1", then records of one type byte (see
+ * SessionTrace::Stream), the time since the previous record in microseconds
+ * as varint, and either the data length as varint followed by the data, or
+ * (EXIT) the exit status as varint.
+ */
+class SessionRecorder {
+public:
+    explicit SessionRecorder(const std::string& path);
+
+    // Wrappers for the pipe functions
+    std::function<void(std::ostream&)> record_stdin(std::function<void(std::ostream&)> fct);
+    std::function<void(std::istream&)> record_stdout(std::function<void(std::istream&)> fct);
+    std::function<void(std::istream&)> record_stderr(std::function<void(std::istream&)> fct);
+
+    // Record the exit status and close the trace
+    void finish(int status);
+
+    // Record a chunk (used by the wrappers)
+    void record(int stream,const char* data,size_t size);
+
+private:
+    std::mutex mutex_;
+    std::ofstream ofs_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+/**
+ * Recorded session, loaded from a trace file, that can be replayed with
+ * another program.
+ */
+class SessionTrace {
+public:
+    // Record types
+    enum Stream { STDIN = 0, STDOUT = 1, STDERR = 2, EXIT = 3 };
+
+    // One record
+    struct Record {
+        Stream stream;
+        std::chrono::microseconds time;     ///< Since the start of the session
+        std::string data;                   ///< Chunk data (empty for EXIT)
+        int status = -1;                    ///< Exit status (EXIT only)
+    };
+
+    // Measurements of a session
+    struct Stats {
+        int status = -1;                    ///< Exit status
+        double seconds = 0;                 ///< Duration until exit
+        double first_output = -1;           ///< Time until the first stdout byte (-1: none)
+        unsigned long long in_bytes = 0;    ///< Bytes written to stdin
+        unsigned long long out_bytes = 0;   ///< Bytes read from stdout
+        unsigned long long err_bytes = 0;   ///< Bytes read from stderr
+        double throughput() const { return seconds>0 ? out_bytes/seconds : 0; }
+    };
+
+    // Result of a replay, with the differences replay minus original
+    struct Report {
+        Stats original;                     ///< As recorded
+        Stats replay;                       ///< As replayed
+        double seconds_delta = 0;           ///< Change of the duration
+        double throughput_delta = 0;        ///< Change of the stdout throughput (bytes/s)
+        std::optional<double> first_output_delta;   ///< Change of the time to first output (none: no output in one of them)
+    };
+
+    // Load a trace file
+    static SessionTrace load(const std::string& path);
+
+    // Replay the session's input to a program
+    Report replay(const std::string& exe,const std::vector<std::string>& args={},bool realtime=true) const;
+
+    const std::vector<Record>& records() const { return records_; }
+    Stats stats() const;
+
+private:
+    std::vector<Record> records_;
+};
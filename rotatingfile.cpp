@@ -0,0 +1,228 @@
+/**
+ * @brief Rotating output file implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <algorithm>
+#include <climits>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "rotatingfile.hpp"
+
+namespace {
+
+// Most bytes moved per splice call
+const size_t splice_size = 1<<20;
+
+/*
+ * Find gzip.
+ */
+std::string find_gzip() {
+    for(auto path : { "/bin/gzip", "/usr/bin/gzip", "/usr/local/bin/gzip" }) {
+        if (access(path,X_OK)==0) return path;
+    }
+    throw std::runtime_error("Can't compress output files: gzip not found");
+}
+
+} // namespace
+
+/**
+ * Open the file. If it exists, new data is appended to it.
+ *
+ * @param path Name of the current segment. Closed segments are put next to it.
+ * @param max_size Rotate when the segment has reached this size (0: never).
+ * @param max_age Rotate when the segment is this old (0: never).
+ * @param compress Compress closed segments with gzip.
+ *
+ * @throws std::exception if an error occurs.
+ */
+RotatingFile::RotatingFile(
+    const std::string& path,
+    unsigned long long max_size,
+    std::chrono::milliseconds max_age,
+    bool compress
+)
+: path_(path)
+, max_size_(max_size)
+, max_age_(max_age)
+, gzip_(compress ? find_gzip() : std::string()) {
+
+    // Continue the numbering of existing segments
+    const auto file = std::filesystem::path(path_);
+    const auto prefix = file.filename().string() + ".";
+    auto dir = file.parent_path();
+    if (dir.empty()) dir = ".";
+    std::error_code ec;
+    for(const auto& entry : std::filesystem::directory_iterator(dir,ec)) {
+        const auto name = entry.path().filename().string();
+        if (name.compare(0,prefix.size(),prefix)!=0) continue;
+        const auto n = strtoul(name.c_str()+prefix.size(),nullptr,10);
+        if (n>=next_) next_ = n+1;
+    }
+
+    open_segment();
+}
+
+/**
+ * Close the file, and wait until closed segments are compressed.
+ */
+RotatingFile::~RotatingFile() {
+    close(fd_);
+    for(auto& f : compressing_) {
+        try {
+            f.get();
+        } catch(const std::exception&) {
+            // Leave the segment uncompressed
+        }
+    }
+}
+
+/**
+ * Close the current segment now, unless it's empty.
+ *
+ * @throws std::exception if the new segment can't be created.
+ */
+void RotatingFile::rotate() {
+    std::lock_guard<std::mutex> _(mutex_);
+    if (size_>0) rotate_locked();
+}
+
+/**
+ * Get the names of the closed segments, oldest first. With compression,
+ * these are the names of the compressed files, which may not be complete
+ * yet (see `wait`).
+ */
+std::vector<std::string> RotatingFile::segments() const {
+    std::lock_guard<std::mutex> _(mutex_);
+    return segments_;
+}
+
+/**
+ * Get the size of the current segment.
+ */
+unsigned long long RotatingFile::size() const {
+    std::lock_guard<std::mutex> _(mutex_);
+    return size_;
+}
+
+/**
+ * Wait until the closed segments are compressed.
+ *
+ * @throws std::exception if gzip failed for a segment.
+ */
+void RotatingFile::wait() {
+    std::vector<std::future<void>> compressing;
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> _(mutex_);
+        compressing.swap(compressing_);
+        error.swap(error_);
+    }
+    for(auto& f : compressing) f.get();
+    if (error) std::rethrow_exception(error);
+}
+
+/**
+ * SpliceTarget interface: Move data from the pipe into the current
+ * segment, rotating when it's full or old enough.
+ *
+ * @throws std::exception if the file can't be written.
+ */
+ssize_t RotatingFile::splice_from(int pipe) {
+    std::lock_guard<std::mutex> _(mutex_);
+    const auto now = std::chrono::steady_clock::now();
+    if (max_age_.count()>0 && now-opened_>=max_age_) {
+        if (size_>0) rotate_locked(); else opened_ = now;   // No empty segments
+    }
+
+    // A segment that's already full (e. g. one continued from a previous
+    // run) must be rotated first, or there'd be no room to splice into
+    if (max_size_ && size_>=max_size_) rotate_locked();
+
+    // Don't write beyond the size limit
+    const auto len = max_size_ ? std::min<unsigned long long>(splice_size,max_size_-size_) : splice_size;
+    for(;;) {
+        const auto n = splice(pipe,nullptr,fd_,nullptr,len,SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n<0 && errno==EINTR) continue;
+        if (n<0 && errno==EAGAIN) return -1;
+        if (n<0) {
+            const auto err = errno;
+            throw std::runtime_error("Error " + std::to_string(err) + " writing " + path_);
+        }
+        size_ += n;
+        if (max_size_ && size_>=max_size_) rotate_locked();
+        return n;
+    }
+}
+
+/**
+ * SpliceTarget interface: Time until the current segment is old enough
+ * to be rotated.
+ */
+int RotatingFile::idle_timeout() {
+    if (max_age_.count()<=0) return -1;
+    std::lock_guard<std::mutex> _(mutex_);
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(opened_+max_age_-std::chrono::steady_clock::now());
+    return static_cast<int>(std::clamp<long long>(left.count(),0,INT_MAX));
+}
+
+/*
+ * Start a new current segment (or continue the existing file).
+ */
+void RotatingFile::open_segment() {
+    fd_ = open(path_.c_str(),O_WRONLY | O_CREAT | O_CLOEXEC,0644);     // Not O_APPEND: splice doesn't allow it
+    struct stat st;
+    if (fd_<0 || fstat(fd_,&st)!=0 || lseek(fd_,0,SEEK_END)<0) {
+        const auto err = errno;
+        if (fd_>=0) close(fd_);
+        fd_ = -1;
+        throw std::runtime_error("Error " + std::to_string(err) + " opening " + path_);
+    }
+    size_ = st.st_size;
+    opened_ = std::chrono::steady_clock::now();
+}
+
+/*
+ * Close the current segment and start a new one.
+ */
+void RotatingFile::rotate_locked() {
+    const auto closed = path_ + "." + std::to_string(next_);
+    if (rename(path_.c_str(),closed.c_str())!=0) {
+        const auto err = errno;
+        throw std::runtime_error("Error " + std::to_string(err) + " renaming " + path_);
+    }
+    ++next_;
+    close(fd_);
+    open_segment();
+
+    if (gzip_.empty()) {
+        segments_.push_back(closed);
+        return;
+    }
+
+    // Compress in the background, forgetting about those that are done
+    segments_.push_back(closed + ".gz");
+    compressing_.erase(std::remove_if(compressing_.begin(),compressing_.end(),[this](std::future<void>& f){
+        if (f.wait_for(std::chrono::seconds(0))!=std::future_status::ready) return false;
+        try {
+            f.get();
+        } catch(const std::exception&) {
+            if (!error_) error_ = std::current_exception();
+        }
+        return true;
+    }),compressing_.end());
+    compressing_.push_back(std::async(std::launch::async,[gzip=gzip_,closed](){
+        const auto status = ChildProcess(gzip,{ "-f", closed }).join();
+        if (!WIFEXITED(status) || WEXITSTATUS(status)!=0) {
+            throw std::runtime_error("Error compressing " + closed);
+        }
+    }));
+}
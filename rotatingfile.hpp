@@ -0,0 +1,80 @@
+/**
+ * @brief Rotating output file header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "childprocess.hpp"
+
+/**
+ * Output file that's rotated by size and/or age, for capturing the output
+ * of long-running processes. The data is spliced from the pipe into the
+ * file in the kernel, without passing through user space:
+ *
+ *      auto log = std::make_shared<RotatingFile>("daemon.log",64<<20,std::chrono::hours(24),true);
+ *      auto out = chld.splice_stdout(log);
+ *      auto err = chld.splice_stderr(log);
+ *
+ * The current segment is always `path`. Rotating renames it to `path.N`
+ * (N counting up from 1, continuing after existing segments) and starts a
+ * new one; this takes two syscalls, so the process isn't held up. Closed
+ * segments are optionally compressed with gzip in the background, giving
+ * `path.N.gz`. Empty segments aren't rotated.
+ */
+class RotatingFile : public ChildProcess::SpliceTarget {
+public:
+    RotatingFile(
+        const std::string& path,
+        unsigned long long max_size,
+        std::chrono::milliseconds max_age=std::chrono::milliseconds(0),
+        bool compress=false
+    );
+    ~RotatingFile();
+
+    RotatingFile(const RotatingFile&) = delete;
+    void operator=(const RotatingFile&) = delete;
+
+    // Close the current segment now (if it's not empty)
+    void rotate();
+
+    // Names of the closed segments, oldest first
+    std::vector<std::string> segments() const;
+
+    // Size of the current segment
+    unsigned long long size() const;
+
+    // Wait until closed segments are compressed; throws if gzip failed
+    void wait();
+
+    // SpliceTarget interface
+    ssize_t splice_from(int pipe) override;
+    int idle_timeout() override;
+
+private:
+    const std::string path_;
+    const unsigned long long max_size_;             // 0: no size limit
+    const std::chrono::milliseconds max_age_;       // 0: no age limit
+    const std::string gzip_;                        // Compressor (empty: don't compress)
+    mutable std::mutex mutex_;
+    int fd_ = -1;                                   // Current segment
+    unsigned long long size_ = 0;                   // Its size
+    std::chrono::steady_clock::time_point opened_;  // When it was started
+    unsigned next_ = 1;                             // Number of the next closed segment
+    std::vector<std::string> segments_;
+    std::vector<std::future<void>> compressing_;
+    std::exception_ptr error_;                      // First compression failure not reported yet
+
+    void open_segment();
+    void rotate_locked();
+};
@@ -0,0 +1,233 @@
+/**
+ * @brief Byte scanning helpers header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#endif
+
+/**
+ * Find the first occurrence of a byte, 16 bytes at a time where SSE2 is
+ * available (it always is on x86-64), with memchr for everything else.
+ *
+ * @returns pointer to the byte, or `end` if there is none.
+ */
+inline const char* find_byte(const char* begin,const char* end,char c) {
+#ifdef __SSE2__
+    const auto needle = _mm_set1_epi8(c);
+    for(;end-begin>=16;begin+=16) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const auto mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block,needle));
+        if (mask) return begin + __builtin_ctz(mask);
+    }
+#endif
+    if (begin==end) return end;
+    const auto p = static_cast<const char*>(std::memchr(begin,c,end-begin));
+    return p ? p : end;
+}
+
+/**
+ * Find the first byte that is not plain ASCII (i. e. has the high bit set)
+ * or is an ESC character, 16 bytes at a time where SSE2 is available.
+ *
+ * @returns pointer to the byte, or `end` if there is none.
+ */
+inline const char* find_non_ascii_or_esc(const char* begin,const char* end) {
+#ifdef __SSE2__
+    const auto esc = _mm_set1_epi8(0x1b);
+    for(;end-begin>=16;begin+=16) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const auto mask = _mm_movemask_epi8(block) | _mm_movemask_epi8(_mm_cmpeq_epi8(block,esc));
+        if (mask) return begin + __builtin_ctz(mask);
+    }
+#endif
+    for(;begin<end;++begin) {
+        if ((*begin & 0x80) || *begin==0x1b) break;
+    }
+    return begin;
+}
+
+/**
+ * Find the first occurrence of either of two bytes, 16 bytes at a time
+ * where SSE2 is available.
+ *
+ * @returns pointer to the byte, or `end` if there is none.
+ */
+inline const char* find_either(const char* begin,const char* end,char a,char b) {
+#ifdef __SSE2__
+    const auto na = _mm_set1_epi8(a);
+    const auto nb = _mm_set1_epi8(b);
+    for(;end-begin>=16;begin+=16) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const auto mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block,na),_mm_cmpeq_epi8(block,nb)));
+        if (mask) return begin + __builtin_ctz(mask);
+    }
+#endif
+    for(;begin<end;++begin) {
+        if (*begin==a || *begin==b) break;
+    }
+    return begin;
+}
+
+/**
+ * Find the first byte outside of a range of ASCII characters, 16 bytes at
+ * a time where SSE2 is available.
+ *
+ * @returns pointer to the byte, or `end` if there is none.
+ */
+inline const char* find_outside(const char* begin,const char* end,char lo,char hi) {
+#ifdef __SSE2__
+    // Signed compares; bytes with the high bit set are negative, i. e. outside
+    const auto below = _mm_set1_epi8(lo);
+    const auto above = _mm_set1_epi8(hi);
+    for(;end-begin>=16;begin+=16) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const auto outside = _mm_or_si128(_mm_cmplt_epi8(block,below),_mm_cmpgt_epi8(block,above));
+        const auto mask = _mm_movemask_epi8(outside);
+        if (mask) return begin + __builtin_ctz(mask);
+    }
+#endif
+    for(;begin<end;++begin) {
+        if (*begin<lo || *begin>hi) break;
+    }
+    return begin;
+}
+
+#ifdef __SSE2__
+namespace simd_detail {
+
+// Shift the bytes of `cur` up by N, filling in the last N bytes of `prev`
+template<int N>
+__attribute__((target("ssse3"))) inline __m128i prev(__m128i cur,__m128i prev) {
+    return _mm_alignr_epi8(cur,prev,16-N);
+}
+
+// High nibble of each byte
+__attribute__((target("ssse3"))) inline __m128i high_nibble(__m128i v) {
+    return _mm_and_si128(_mm_srli_epi16(v,4),_mm_set1_epi8(0x0f));
+}
+
+/*
+ * UTF-8 errors in a block, given the previous block, as a vector that is
+ * non-zero where an error is detected. This is the lookup algorithm of
+ * Keiser and Lemire ("Validating UTF-8 In Less Than One Instruction Per
+ * Byte", 2021): three table lookups on the nibbles of each byte and the
+ * byte before it classify all errors in two-byte windows, and the 3rd and
+ * 4th bytes of long sequences are checked separately.
+ */
+__attribute__((target("ssse3"))) inline __m128i utf8_errors(__m128i cur,__m128i last) {
+    enum : char {
+        TOO_SHORT  = 1<<0,  // Lead byte not followed by a continuation
+        TOO_LONG   = 1<<1,  // ASCII followed by a continuation
+        OVERLONG_3 = 1<<2,  // E0 80..9F
+        TOO_LARGE  = 1<<3,  // F4 90..BF, F5..FF
+        SURROGATE  = 1<<4,  // ED A0..BF
+        OVERLONG_2 = 1<<5,  // C0..C1
+        OVERLONG_4 = 1<<6,  // F0 80..8F (also F5..FF 80..8F)
+        TWO_CONTS  = char(1<<7),// Continuation after continuation
+        CARRY      = TOO_SHORT | TOO_LONG | TWO_CONTS
+    };
+    const auto prev1 = prev<1>(cur,last);
+    const auto byte_1_high = _mm_shuffle_epi8(_mm_setr_epi8(
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | OVERLONG_4
+    ),high_nibble(prev1));
+    const auto byte_1_low = _mm_shuffle_epi8(_mm_setr_epi8(
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | OVERLONG_4,
+        CARRY | TOO_LARGE | OVERLONG_4,
+        CARRY | TOO_LARGE | OVERLONG_4,
+        CARRY | TOO_LARGE | OVERLONG_4,
+        CARRY | TOO_LARGE | OVERLONG_4,
+        CARRY | TOO_LARGE | OVERLONG_4,
+        CARRY | TOO_LARGE | OVERLONG_4,
+        CARRY | TOO_LARGE | OVERLONG_4,
+        CARRY | TOO_LARGE | OVERLONG_4 | SURROGATE,
+        CARRY | TOO_LARGE | OVERLONG_4,
+        CARRY | TOO_LARGE | OVERLONG_4
+    ),_mm_and_si128(prev1,_mm_set1_epi8(0x0f)));
+    const auto byte_2_high = _mm_shuffle_epi8(_mm_setr_epi8(
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+    ),high_nibble(cur));
+    const auto special = _mm_and_si128(_mm_and_si128(byte_1_high,byte_1_low),byte_2_high);
+
+    // Bytes 2 or 3 after a 3 or 4 byte lead must be continuations
+    const auto third = _mm_subs_epu8(prev<2>(cur,last),_mm_set1_epi8(char(0xe0-0x80)));
+    const auto fourth = _mm_subs_epu8(prev<3>(cur,last),_mm_set1_epi8(char(0xf0-0x80)));
+    const auto must_continue = _mm_and_si128(_mm_or_si128(third,fourth),_mm_set1_epi8(char(0x80)));
+    return _mm_xor_si128(must_continue,special);
+}
+
+/*
+ * Non-zero where a block ends in the middle of a sequence.
+ */
+__attribute__((target("ssse3"))) inline __m128i utf8_incomplete(__m128i v) {
+    const auto max = _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+        char(0xf0-1),char(0xe0-1),char(0xc0-1));
+    return _mm_subs_epu8(v,max);
+}
+
+__attribute__((target("ssse3"))) inline const char* skip_utf8_ssse3(const char* begin,const char* end) {
+    const auto esc = _mm_set1_epi8(0x1b);
+    auto last = _mm_setzero_si128();
+    auto incomplete = _mm_setzero_si128();
+    auto p = begin;
+    for(;end-p>=16;p+=16) {
+        const auto cur = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(cur,esc))) break;
+        const auto errors = _mm_movemask_epi8(cur)
+            ? utf8_errors(cur,last)
+            : incomplete;
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(errors,_mm_setzero_si128()))!=0xffff) break;
+        incomplete = utf8_incomplete(cur);
+        last = cur;
+    }
+
+    // Back up to the start of the last sequence, which may be incomplete
+    while(p>begin && (static_cast<unsigned char>(p[-1]) & 0xc0)==0x80) --p;
+    if (p>begin && static_cast<unsigned char>(p[-1])>=0xc0) --p;
+    return p;
+}
+
+} // namespace simd_detail
+#endif
+
+/**
+ * Skip valid UTF-8 without ESC characters, 16 bytes at a time with SSSE3
+ * (checked at runtime), or up to the first non-ASCII byte without it.
+ * Stops somewhere before the first invalid or incomplete sequence or ESC,
+ * but not necessarily right at it; the caller must check the bytes from
+ * there on itself.
+ *
+ * @returns pointer to the start of a sequence that hasn't been checked, or
+ *          `end` if all of them have.
+ */
+inline const char* skip_valid_utf8(const char* begin,const char* end) {
+#ifdef __SSE2__
+    static const bool ssse3 = __builtin_cpu_supports("ssse3");
+    if (ssse3) return simd_detail::skip_utf8_ssse3(begin,end);
+#endif
+    return find_non_ascii_or_esc(begin,end);
+}
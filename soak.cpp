@@ -0,0 +1,262 @@
+/**
+ * @brief Child Process Manager soak test
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ *
+ * Runs spawn/pipe/join cycles in several threads for a long time, and
+ * watches the process for leaks and slowdown. Usage:
+ *
+ *   childprocess-soak [options]
+ *
+ *   --duration=SECONDS  Run time (default 60)
+ *   --cycles=N          Stop after N cycles (default 0: no limit)
+ *   --concurrency=N     Worker threads, each with one child at a time (default 8)
+ *   --interval=SECONDS  Time between reports (default 1)
+ *   --decay=PERCENT     Fail if the spawn rate drops by more than this (default 50)
+ *   --rss=MB            Fail if memory grows by more than this (default 16)
+ *
+ * Each report line shows the cycles done, spawns per second in the last
+ * interval, open fds, threads, zombie children, and resident memory. At
+ * the end, fds and threads must be back where they were before the start,
+ * there must be no zombies, memory must not have grown by more than allowed
+ * since the first interval, and the spawn rate of the last third of the run must be
+ * at least (100-decay)% of the first third's. Exits with EXIT_FAILURE
+ * otherwise, or if any cycle failed.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "childprocess.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/*
+ * Full path name of the synthetic workload program, which is built
+ * next to this program.
+ */
+std::string workload() {
+    static const auto path = (std::filesystem::read_symlink("/proc/self/exe").parent_path() / "childprocess-workload").string();
+    return path;
+}
+
+// Resource usage of this process
+struct Usage {
+    long fds = 0;
+    long threads = 0;
+    long zombies = 0;
+    double rss = 0;                         // MB
+};
+
+/*
+ * Measure the resource usage of this process.
+ */
+Usage usage() {
+    Usage ret;
+
+    for(const auto& e : std::filesystem::directory_iterator("/proc/self/fd")) {
+        (void)e;
+        ++ret.fds;
+    }
+    --ret.fds;                              // The directory iterator's own
+
+    std::ifstream status("/proc/self/status");
+    for(std::string line;std::getline(status,line);) {
+        if (line.compare(0,8,"Threads:")==0) ret.threads = std::atol(line.c_str()+8);
+        if (line.compare(0,6,"VmRSS:")==0) ret.rss = std::atol(line.c_str()+6)/1024.0;
+    }
+
+    // Zombies: our children in state Z (field 3, then PPID in field 4)
+    const auto self = getpid();
+    for(const auto& e : std::filesystem::directory_iterator("/proc")) {
+        const auto name = e.path().filename().string();
+        if (name.find_first_not_of("0123456789")!=std::string::npos) continue;
+        std::ifstream ifs(e.path()/"stat");
+        std::string stat;
+        if (!std::getline(ifs,stat)) continue;
+        const auto paren = stat.rfind(')');
+        char state;
+        int ppid;
+        if (paren!=std::string::npos && sscanf(stat.c_str()+paren+2,"%c %d",&state,&ppid)==2 && ppid==self && state=='Z') {
+            ++ret.zombies;
+        }
+    }
+    return ret;
+}
+
+/*
+ * One spawn/pipe/join cycle, using a different part of the API each time.
+ *
+ * @returns true if the child did what was expected.
+ */
+bool cycle(unsigned long n) {
+    const auto data = "cycle " + std::to_string(n) + "\n";
+    switch(n%4) {
+        case 0: {
+            // Streams through I/O threads
+            ChildProcess chld(workload(),{ "--echo" },ChildProcess::IN | ChildProcess::OUT);
+            auto in = chld.make_stdin([&data](std::ostream& os){ os << data; });
+            std::string out;
+            auto rd = chld.get_stdout([&out](std::istream& is){
+                out.assign(std::istreambuf_iterator<char>(is),std::istreambuf_iterator<char>());
+            });
+            in.get();
+            rd.get();
+            return chld.join()==0 && out==data;
+        }
+
+        case 1: {
+            // Poll loop in this thread
+            ChildProcess chld(workload(),{ "--echo", "--stderr" },ChildProcess::IN | ChildProcess::ERR);
+            std::string err;
+            chld.pump(
+                ChildProcess::from_range(std::vector<std::string>{ data }),
+                {},
+                [&err](std::string_view chunk){ err.append(chunk); }
+            );
+            return chld.join()==0 && err==data;
+        }
+
+        case 2: {
+            // No pipes, exit status
+            return ChildProcess(workload(),{ "--exit=3" }).join()>>8==3;
+        }
+
+        default: {
+            // Pipes that are never used, terminated by the dtor
+            ChildProcess chld(workload(),{ "--exit-delay=60000" },ChildProcess::IN | ChildProcess::OUT | ChildProcess::ERR);
+            return chld.pid()>0;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc,char** argv) {
+    double duration = 60, interval = 1, decay = 50, rss_limit = 16;
+    unsigned long max_cycles = 0;
+    unsigned concurrency = 8;
+
+    static const option options[] = {
+        { "duration",    required_argument, nullptr, 'd' },
+        { "cycles",      required_argument, nullptr, 'n' },
+        { "concurrency", required_argument, nullptr, 'c' },
+        { "interval",    required_argument, nullptr, 'i' },
+        { "decay",       required_argument, nullptr, 'D' },
+        { "rss",         required_argument, nullptr, 'r' },
+        { nullptr,       0,                 nullptr, 0   }
+    };
+
+    for(int opt;(opt=getopt_long(argc,argv,"",options,nullptr))!=-1;) {
+        switch(opt) {
+            case 'd': duration    = std::atof(optarg); break;
+            case 'n': max_cycles  = std::strtoul(optarg,nullptr,10); break;
+            case 'c': concurrency = std::max(1,std::atoi(optarg)); break;
+            case 'i': interval    = std::max(0.1,std::atof(optarg)); break;
+            case 'D': decay       = std::atof(optarg); break;
+            case 'r': rss_limit   = std::atof(optarg); break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [--duration=SECONDS] [--cycles=N] [--concurrency=N]"
+                    " [--interval=SECONDS] [--decay=PERCENT] [--rss=MB]\n";
+                return EXIT_FAILURE;
+        }
+    }
+
+    const auto idle = usage();
+
+    // Run the workers
+    std::atomic<unsigned long> next{0}, done{0}, failed{0};
+    std::atomic<bool> stop{false};
+    std::mutex mutex;
+    std::vector<std::string> errors;
+    std::vector<std::thread> workers;
+    const auto start = Clock::now();
+    for(unsigned i=0;i<concurrency;++i) {
+        workers.emplace_back([&](){
+            while(!stop) {
+                const auto n = next++;
+                if (max_cycles && n>=max_cycles) break;
+                try {
+                    if (!cycle(n)) ++failed;
+                } catch(const std::exception& e) {
+                    ++failed;
+                    std::lock_guard<std::mutex> _(mutex);
+                    if (errors.size()<10) errors.push_back(e.what());
+                }
+                ++done;
+            }
+        });
+    }
+
+    // Report until done
+    std::cout << std::setw(8) << "seconds" << std::setw(12) << "cycles" << std::setw(12) << "spawns/s"
+        << std::setw(8) << "fds" << std::setw(8) << "threads" << std::setw(8) << "zombies" << std::setw(10) << "rss MB\n";
+    std::vector<double> rates;
+    Usage baseline;
+    auto last = start;
+    auto last_spawns = ChildProcess::stats().spawns.load();
+    for(;;) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+        const auto now = Clock::now();
+        const auto spawns = ChildProcess::stats().spawns.load();
+        const auto rate = (spawns-last_spawns)/std::chrono::duration<double>(now-last).count();
+        last = now;
+        last_spawns = spawns;
+
+        const auto u = usage();
+        if (rates.empty()) baseline = u;
+        rates.push_back(rate);
+        std::cout << std::fixed << std::setprecision(1)
+            << std::setw(8) << std::chrono::duration<double>(now-start).count()
+            << std::setw(12) << done.load()
+            << std::setw(12) << rate
+            << std::setw(8) << u.fds << std::setw(8) << u.threads << std::setw(8) << u.zombies
+            << std::setw(10) << u.rss << std::endl;
+
+        if (std::chrono::duration<double>(now-start).count()>=duration || (max_cycles && done>=max_cycles)) break;
+    }
+    stop = true;
+    for(auto& w : workers) w.join();
+
+    // Check the results
+    auto ok = true;
+    const auto check = [&ok](bool cond,const std::string& what) {
+        if (!cond) {
+            std::cout << "FAILED: " << what << "\n";
+            ok = false;
+        }
+    };
+    const auto end = usage();
+    check(failed==0,std::to_string(failed.load()) + " of " + std::to_string(done.load()) + " cycles failed");
+    for(const auto& e : errors) std::cout << "  " << e << "\n";
+    check(end.fds<=idle.fds,"fd leak (" + std::to_string(idle.fds) + " -> " + std::to_string(end.fds) + ")");
+    check(end.threads<=idle.threads,"thread leak (" + std::to_string(idle.threads) + " -> " + std::to_string(end.threads) + ")");
+    check(end.zombies==0,std::to_string(end.zombies) + " zombies");
+    check(end.rss-baseline.rss<=rss_limit,"memory grew by " + std::to_string(end.rss-baseline.rss) + " MB");
+    if (rates.size()>=3) {
+        const auto third = rates.size()/3;
+        const auto first = std::accumulate(rates.begin(),rates.begin()+third,0.0)/third;
+        const auto final = std::accumulate(rates.end()-third,rates.end(),0.0)/third;
+        check(final>=first*(100-decay)/100,"spawn rate decayed from " + std::to_string(first) + " to " + std::to_string(final) + "/s");
+    }
+
+    std::cout << (ok ? "PASSED" : "FAILED") << ": " << done.load() << " cycles in "
+        << std::chrono::duration<double>(Clock::now()-start).count() << " seconds\n";
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
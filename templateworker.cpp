@@ -0,0 +1,217 @@
+/**
+ * @brief Pre-initialized worker processes implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "forkserver.hpp"
+#include "templateworker.hpp"
+
+namespace {
+
+/*
+ * Send a request, with fds as SCM_RIGHTS.
+ */
+void send_request(int sock,const ForkServer::Request& req,const int* fds,size_t count) {
+    char control[CMSG_SPACE(3*sizeof(int))] = {};
+    iovec iov = { const_cast<ForkServer::Request*>(&req), sizeof(req) };
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (count) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(count*sizeof(int));
+        const auto cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(count*sizeof(int));
+        memcpy(CMSG_DATA(cmsg),fds,count*sizeof(int));
+    }
+
+    ssize_t ret;
+    while((ret=sendmsg(sock,&msg,MSG_NOSIGNAL))<0 && errno==EINTR) {}
+    if (ret<0) {
+        const auto err = errno;
+        throw std::runtime_error("Error " + std::to_string(err) + " sending to the template worker");
+    }
+}
+
+} // namespace
+
+/**
+ * Start a template worker. Returns when the program has been started, not
+ * when it's initialized; `fork` requests wait for that.
+ *
+ * @param exe,args,init,env See the ChildProcess ctor.
+ *
+ * @throws std::exception if an error occurs.
+ */
+std::shared_ptr<TemplateWorker> TemplateWorker::start(
+    const std::string& exe,
+    const std::vector<std::string>& args,
+    std::function<void()> init,
+    EnvBlock env
+) {
+    int sv[2];
+    if (socketpair(AF_UNIX,SOCK_SEQPACKET | SOCK_CLOEXEC,0,sv)) {
+        const auto err = errno;
+        throw std::runtime_error("Error " + std::to_string(err) + " creating the control socket");
+    }
+
+    // Pass the template's end in the environment
+    const auto fd = std::to_string(sv[1]);
+    if (env.envp()) env = EnvBlock(env,{{ ForkServer::env, fd }});
+    try {
+        auto tmpl = ChildProcess(exe,args,0,[sv,fd,init](){
+            fcntl(sv[1],F_SETFD,0);
+            setenv(ForkServer::env,fd.c_str(),1);
+            init();
+        },std::move(env));
+        close(sv[1]);
+        return std::shared_ptr<TemplateWorker>(new TemplateWorker(std::move(tmpl),sv[0],exe));
+    } catch(...) {
+        close(sv[0]);
+        close(sv[1]);
+        throw;
+    }
+}
+
+/*
+ * Take over the template process and start reading its replies.
+ */
+TemplateWorker::TemplateWorker(ChildProcess tmpl,int sock,std::string exe)
+: template_(std::move(tmpl))
+, sock_(sock)
+, exe_(std::move(exe))
+, reader_([this](){ read_replies(); }) {}
+
+/**
+ * Tell the template to exit; the ChildProcess dtor then makes sure it does.
+ */
+TemplateWorker::~TemplateWorker() {
+    shutdown(sock_,SHUT_RDWR);
+    reader_.join();
+    close(sock_);
+}
+
+/**
+ * Fork a pre-initialized copy of the template. Waits until the template
+ * has finished its initialization, if necessary.
+ *
+ * @param flags Combination of IN, OUT, and ERR: which pipes to create.
+ *              The others are inherited from the template.
+ *
+ * @returns the copy.
+ *
+ * @throws std::exception if an error occurs (e. g. the template has exited).
+ */
+ChildProcess TemplateWorker::fork(int flags) {
+    return ChildProcess(shared_from_this(),exe_,{},flags);
+}
+
+/**
+ * Backend interface: Have the template fork a copy with the given fds.
+ * `exe`, `args`, `init`, and `env` are ignored; the copy continues where
+ * the template called ForkServer::serve().
+ */
+pid_t TemplateWorker::spawn(
+    const std::string&,
+    const std::vector<std::string>&,
+    int,
+    const std::function<void()>&,
+    const EnvBlock&,
+    const int fds[3]
+) {
+    ForkServer::Request req = { ForkServer::Request::FORK, 0, 0, 0 };
+    int send[3];
+    size_t count = 0;
+    for(auto i=0;i<3;++i) {
+        if (fds[i]>=0) {
+            req.fds |= 1u<<i;
+            send[count++] = fds[i];
+        }
+    }
+
+    std::lock_guard<std::mutex> _(spawn_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (gone_) {
+        throw std::runtime_error("The template worker " + exe_ + " has exited");
+    }
+    forked_.reset();
+    send_request(sock_,req,send,count);
+    cv_.wait(lock,[this](){ return forked_ || gone_; });
+
+    if (!forked_) {
+        throw std::runtime_error("The template worker " + exe_ + " has exited");
+    }
+    if (*forked_<0) {
+        throw std::runtime_error("Error " + std::to_string(-*forked_) + " forking a copy of " + exe_);
+    }
+    return *forked_;
+}
+
+/**
+ * Backend interface: Wait for a copy to exit. If the template has exited
+ * before the copy, returns -1.
+ */
+std::optional<int> TemplateWorker::wait(pid_t pid,bool nohang) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const auto done = [&](){ return exited_.count(pid) || gone_; };
+    if (nohang && !done()) return std::nullopt;
+    cv_.wait(lock,done);
+
+    const auto it = exited_.find(pid);
+    if (it==exited_.end()) return -1;
+    const auto status = it->second;
+    exited_.erase(it);
+    return status;
+}
+
+/**
+ * Backend interface: Send a signal to a copy (through the template).
+ */
+void TemplateWorker::signal(pid_t pid,int sig) {
+    std::lock_guard<std::mutex> _(mutex_);
+    if (gone_ || exited_.count(pid)) return;
+    try {
+        send_request(sock_,{ ForkServer::Request::SIGNAL, 0, pid, sig },nullptr,0);
+    } catch(const std::exception&) {
+        // Template has gone; the reader will notice
+    }
+}
+
+/*
+ * Read the template's replies until it exits.
+ */
+void TemplateWorker::read_replies() {
+    for(;;) {
+        ForkServer::Reply reply;
+        const auto n = recv(sock_,&reply,sizeof(reply),0);
+        if (n<0 && errno==EINTR) continue;
+
+        std::lock_guard<std::mutex> _(mutex_);
+        if (n!=sizeof(reply)) {
+            gone_ = true;
+            cv_.notify_all();
+            return;
+        }
+        switch(reply.type) {
+            case ForkServer::Reply::FORKED:
+                // A reused PID: forget the status of the earlier copy, which
+                // would otherwise be taken for this one's
+                exited_.erase(reply.pid);
+                forked_ = reply.pid;
+                break;
+            case ForkServer::Reply::FAILED: forked_ = -reply.value; break;
+            case ForkServer::Reply::EXITED: exited_[reply.pid] = reply.value; break;
+        }
+        cv_.notify_all();
+    }
+}
@@ -0,0 +1,87 @@
+/**
+ * @brief Pre-initialized worker processes header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "childprocess.hpp"
+
+/**
+ * Template worker: a program that initializes once, and then forks
+ * pre-initialized copies of itself on request, so that starting another
+ * worker doesn't take the initialization time again.
+ *
+ * The program calls ForkServer::serve() (see forkserver.hpp) after its
+ * initialization. Each copy is a ChildProcess with its own pipes and exit
+ * status, like any other:
+ *
+ *      auto model = TemplateWorker::start("/usr/bin/classifier",{ "--model=big" });
+ *      auto chld = model->fork(ChildProcess::IN | ChildProcess::OUT);
+ *      auto in  = chld.make_stdin(...);
+ *      auto out = chld.get_stdout(...);
+ *      const auto status = chld.join();
+ *
+ * The copies are children of the template, not of us, so the template
+ * reports their exit status and forwards signals to them (which makes
+ * this as safe against PID reuse as ChildProcess::signal). The template
+ * exits when the TemplateWorker and all copies' ChildProcess objects are
+ * gone; copies still running then keep running.
+ */
+class TemplateWorker : public ChildProcess::Backend, public std::enable_shared_from_this<TemplateWorker> {
+public:
+    // Start the template (parameters as for the ChildProcess ctor)
+    static std::shared_ptr<TemplateWorker> start(
+        const std::string& exe,
+        const std::vector<std::string>& args={},
+        std::function<void()> init=[](){},
+        EnvBlock env={}
+    );
+
+    ~TemplateWorker();
+
+    // Fork a copy; flags: IN, OUT, ERR
+    ChildProcess fork(int flags=0);
+
+    // The template process
+    pid_t pid() const { return template_.pid(); }
+
+    // Backend interface
+    pid_t spawn(
+        const std::string& exe,
+        const std::vector<std::string>& args,
+        int flags,
+        const std::function<void()>& init,
+        const EnvBlock& env,
+        const int fds[3]
+    ) override;
+    std::optional<int> wait(pid_t pid,bool nohang) override;
+    void signal(pid_t pid,int sig) override;
+
+private:
+    TemplateWorker(ChildProcess tmpl,int sock,std::string exe);
+
+    ChildProcess template_;             // The template process
+    int sock_;                          // Our end of the control socket
+    std::string exe_;                   // The template's program
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::mutex spawn_;                  // One FORK request at a time
+    std::optional<int> forked_;         // Reply to the FORK request (PID or -errno)
+    std::map<pid_t,int> exited_;        // Exit status of copies not waited for yet
+    bool gone_ = false;                 // The template has exited
+    std::thread reader_;                // Reads the replies
+
+    void read_replies();
+};
@@ -6,15 +6,33 @@
  * @copyright MIT license
  */
 
+#include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <future>
 #include <unordered_set>
+#include <sched.h>
+#include <sys/wait.h>
 
 #define BOOST_TEST_MODULE childprocess
 #include <boost/test/unit_test.hpp>
 
 #include "childprocess.hpp"
+#include "fakebackend.hpp"
+#include "heartbeat.hpp"
+#include "jobgroup.hpp"
+#include "joblog.hpp"
+#include "jobrunner.hpp"
+#include "lineindex.hpp"
+#include "linelimiter.hpp"
+#include "metrics.hpp"
+#include "monitor.hpp"
+#include "ndjson.hpp"
+#include "pipeline.hpp"
+#include "recorder.hpp"
+#include "rotatingfile.hpp"
+#include "templateworker.hpp"
+#include "textfilter.hpp"
 
 BOOST_AUTO_TEST_SUITE(childprocess)
 
@@ -248,4 +266,1020 @@ BOOST_FIXTURE_TEST_CASE(except,Fx) {
     BOOST_TEST(gotE==exE);
 }
 
+/*
+ * Test running the I/O threads on the child's CPUs.
+ */
+BOOST_FIXTURE_TEST_CASE(pincore,Fx) {
+
+    // Pin the child to the last CPU we're allowed to use
+    cpu_set_t mask;
+    sched_getaffinity(0,sizeof(mask),&mask);
+    auto cpu = CPU_SETSIZE-1;
+    while(cpu>0 && !CPU_ISSET(cpu,&mask)) --cpu;
+
+    auto chld = ChildProcess("/bin/true",{},
+        ChildProcess::OUT | ChildProcess::PINCORE,
+        [cpu](){
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu,&set);
+            sched_setaffinity(0,sizeof(set),&set);
+        }
+    );
+
+    // The reader thread must run on the same CPU
+    cpu_set_t reader;
+    chld.get_stdout([&reader](std::istream&){
+        sched_getaffinity(0,sizeof(reader),&reader);
+    }).get();
+    chld.join();
+
+    BOOST_TEST(CPU_COUNT(&reader)==1);
+    BOOST_TEST(CPU_ISSET(cpu,&reader));
+}
+
+/*
+ * Test starting processes with a shared environment block.
+ */
+BOOST_FIXTURE_TEST_CASE(envblock,Fx) {
+
+    const auto value = std::to_string(rand());
+    setenv("CHILDPROCESS_REMOVED","1",1);
+
+    const auto env = EnvBlock({},{
+        { "CHILDPROCESS_VALUE", value },
+        { "CHILDPROCESS_REMOVED", std::nullopt }
+    });
+    BOOST_TEST(env.get("CHILDPROCESS_VALUE")==value);
+    BOOST_TEST(!env.get("CHILDPROCESS_REMOVED"));
+    BOOST_TEST(env.get("PATH")==getenv("PATH"));
+
+    // Use the same block for several processes
+    for(auto i=0;i<3;++i) {
+        auto chld = ChildProcess("/bin/sh",
+            { "-c", "echo $CHILDPROCESS_VALUE${CHILDPROCESS_REMOVED-}" },
+            ChildProcess::OUT,[](){},env
+        );
+        std::string output;
+        chld.get_stdout([&output](std::istream& is){ std::getline(is,output); }).get();
+        BOOST_TEST(chld.join()==0);
+        BOOST_TEST(output==value);
+    }
+    unsetenv("CHILDPROCESS_REMOVED");
+}
+
+/*
+ * Test monitoring a running process and killing it above a CPU threshold.
+ */
+BOOST_FIXTURE_TEST_CASE(monitor,Fx) {
+
+    ProcessMonitor mon(std::chrono::milliseconds(20));
+
+    // Remember what the threshold callback saw, then kill the process
+    std::promise<ProcessMonitor::Sample> seen;
+    std::once_flag once;
+    const auto kill = ProcessMonitor::kill_process();
+    mon.on_threshold(ProcessMonitor::CPU,10,[&](pid_t pid,const ProcessMonitor::Sample& s){
+        std::call_once(once,[&](){ seen.set_value(s); });
+        kill(pid,s);
+    });
+
+    // Run a process that burns CPU forever
+    auto chld = ChildProcess("/bin/sh",{ "-c", "while :; do :; done" });
+    const auto s = seen.get_future().get();
+    BOOST_TEST(s.cpu>10);
+    BOOST_TEST(s.rss>0);
+    BOOST_TEST(mon.series(chld.pid()).size()>0);
+
+    const auto status = chld.join();
+    BOOST_TEST(WIFSIGNALED(status));
+    BOOST_TEST(WTERMSIG(status)==SIGKILL);
+}
+
+/*
+ * Test collecting delay accounting.
+ */
+BOOST_FIXTURE_TEST_CASE(delays,Fx) {
+
+    auto chld = ChildProcess("/bin/sh",
+        { "-c", "i=0; while [ $i -lt 10000 ]; do i=$((i+1)); done" },
+        ChildProcess::DELAYS
+    );
+    BOOST_TEST(!chld.delays().valid);
+    BOOST_TEST(chld.join()==0);
+
+    // taskstats may be unavailable (e. g. in containers); if it is
+    // available, a process that ran must have been scheduled.
+    const auto& d = chld.delays();
+    BOOST_TEST_MESSAGE("taskstats " << (d.valid ? "" : "not ") << "available, "
+        << d.cpu_count << " CPU delays, " << d.cpu.count() << "ns");
+    BOOST_TEST((!d.valid || d.cpu_count>0));
+}
+
+/*
+ * Test counting the I/O through the pipes.
+ */
+BOOST_FIXTURE_TEST_CASE(iostats,Fx) {
+
+    const auto before = ChildProcess::total_io_stats().bytes_read.load();
+    const auto size = 100000;
+
+    auto chld = ChildProcess("/bin/cat",{},ChildProcess::IN | ChildProcess::OUT);
+    auto in = chld.make_stdin([](std::ostream& os){ os << std::string(size,'x'); });
+    auto recv = std::string();
+    auto out = chld.get_stdout([&recv](std::istream& is){
+        recv.assign(std::istreambuf_iterator<char>(is),std::istreambuf_iterator<char>());
+    });
+    in.get();
+    out.get();
+    BOOST_TEST(chld.join()==0);
+
+    const auto& io = chld.io_stats();
+    BOOST_TEST(recv.size()==size);
+    BOOST_TEST(io.bytes_written==size);
+    BOOST_TEST(io.bytes_read==size);
+    BOOST_TEST(io.writes>0);
+    BOOST_TEST(io.reads>io.bytes_read/4096);  // Including the read that returns EOF
+    BOOST_TEST(io.max_fill>0);
+    BOOST_TEST(ChildProcess::total_io_stats().bytes_read-before>=size);
+}
+
+/*
+ * Test exporting metrics in Prometheus format.
+ */
+BOOST_FIXTURE_TEST_CASE(metrics,Fx) {
+
+    const auto spawns = ChildProcess::stats().spawns.load();
+    ChildProcess("/bin/true").join();
+    BOOST_TEST(ChildProcess::stats().spawns==spawns+1);
+
+    write_prometheus_metrics(tmpfile);
+    std::ifstream ifs(tmpfile);
+    const auto text = std::string(std::istreambuf_iterator<char>(ifs),std::istreambuf_iterator<char>());
+
+    BOOST_TEST(text.find("childprocess_spawns_total " + std::to_string(spawns+1) + "\n")!=std::string::npos);
+    BOOST_TEST(text.find("# TYPE childprocess_spawn_duration_seconds histogram\n")!=std::string::npos);
+    BOOST_TEST(text.find("childprocess_spawn_duration_seconds_bucket{le=\"+Inf\"} ")!=std::string::npos);
+    BOOST_TEST(text.find("childprocess_running ")!=std::string::npos);
+    BOOST_TEST(text.find("childprocess_open_fds ")!=std::string::npos);
+
+    // The sum is exported to the nanosecond, not rounded to 6 digits
+    const auto& spawn_ns = ChildProcess::stats().spawn_latency.sum_ns;
+    while(spawn_ns<10'000'000 || spawn_ns%1000==0) ChildProcess("/bin/true").join();
+    const auto exported = prometheus_metrics();
+    const auto sum = exported.find("childprocess_spawn_duration_seconds_sum ");
+    BOOST_REQUIRE(sum!=std::string::npos);
+    const auto seconds = std::stod(exported.substr(exported.find(' ',sum)+1));
+    BOOST_TEST(std::llround(seconds*1e9)==static_cast<long long>(spawn_ns.load()));
+
+    // Only a running process that is destroyed has a reap latency: join
+    // can't tell how long ago the process terminated
+    const auto reaps = [](){
+        auto total = 0ULL;
+        for(const auto& count : ChildProcess::stats().reap_latency.counts) total += count.load();
+        return total;
+    };
+    const auto before = reaps();
+    ChildProcess("/bin/true").join();
+    BOOST_TEST(reaps()==before);
+    ChildProcess("/bin/sleep",{ "10" });
+    BOOST_TEST(reaps()==before+1);
+}
+
+/*
+ * Test recording a session and replaying it.
+ */
+BOOST_FIXTURE_TEST_CASE(replay,Fx) {
+
+    // Record a session with cat
+    {
+        SessionRecorder rec(tmpfile);
+        auto chld = ChildProcess("/bin/cat",{},ChildProcess::IN | ChildProcess::OUT);
+        auto in = chld.make_stdin(rec.record_stdin([](std::ostream& os){
+            for(auto i=0;i<5;++i) {
+                os << "line " << i << std::endl;
+            }
+        }));
+        std::string output;
+        auto out = chld.get_stdout(rec.record_stdout([&output](std::istream& is){
+            output.assign(std::istreambuf_iterator<char>(is),std::istreambuf_iterator<char>());
+        }));
+        in.get();
+        out.get();
+        rec.finish(chld.join());
+        BOOST_TEST(output.size()==35);
+    }
+
+    // Check what was recorded
+    const auto trace = SessionTrace::load(tmpfile);
+    const auto st = trace.stats();
+    BOOST_TEST(st.status==0);
+    BOOST_TEST(st.in_bytes==35);
+    BOOST_TEST(st.out_bytes==35);
+    BOOST_TEST(trace.records().front().stream==SessionTrace::STDIN);
+    BOOST_TEST(trace.records().front().data=="line 0\n");
+    BOOST_TEST(trace.records().back().stream==SessionTrace::EXIT);
+
+    // Replay it with another program
+    const auto report = trace.replay("/usr/bin/tr",{ "a-z", "A-Z" },false);
+    BOOST_TEST(report.replay.status==0);
+    BOOST_TEST(report.replay.in_bytes==35);
+    BOOST_TEST(report.replay.out_bytes==35);
+    BOOST_TEST(report.replay.first_output>=0);
+    BOOST_TEST(report.seconds_delta==report.replay.seconds-report.original.seconds);
+    BOOST_TEST(report.throughput_delta==report.replay.throughput()-report.original.throughput());
+    BOOST_REQUIRE(report.first_output_delta.has_value());
+    BOOST_TEST(*report.first_output_delta==report.replay.first_output-report.original.first_output);
+
+    // A data length beyond the end of the file is rejected before allocating
+    {
+        std::ofstream ofs(tmpfile,std::ios::binary);
+        ofs << "CPTRACE1" << char(SessionTrace::STDOUT) << char(0);
+        for(auto i=0;i<8;++i) ofs << char(0xff);
+        ofs << char(0x3f) << "data";
+    }
+    BOOST_CHECK_THROW(SessionTrace::load(tmpfile),std::runtime_error);
+}
+
+/*
+ * Test running fake processes instead of real ones.
+ */
+BOOST_FIXTURE_TEST_CASE(fake,Fx) {
+
+    auto fake = std::make_shared<FakeBackend>();
+    FakeBackend::Script grep;
+    grep.out = "42\n";
+    grep.exit_code = 3;
+    grep.expect_in = "1\n42\n";
+    fake->expect("/no/such/grep",grep);
+    FakeBackend::Script hang;
+    hang.delay = std::chrono::hours(1);
+    fake->expect("/no/such/daemon",hang);
+    const auto previous = ChildProcess::install(fake);
+
+    // Talk to a fake process
+    {
+        auto chld = ChildProcess("/no/such/grep",{ "^42$" },ChildProcess::IN | ChildProcess::OUT);
+        auto in = chld.make_stdin([](std::ostream& os){ os << "1\n42\n"; });
+        int recv = -1;
+        auto out = chld.get_stdout([&recv](std::istream& is){ is >> recv; });
+        in.get();
+        out.get();
+        const auto status = chld.join();
+        BOOST_TEST(WIFEXITED(status));
+        BOOST_TEST(WEXITSTATUS(status)==3);
+        BOOST_TEST(recv==42);
+    }
+
+    // The dtor terminates a fake process
+    { ChildProcess("/no/such/daemon"); }
+
+    // Unknown programs are rejected
+    BOOST_CHECK_THROW(ChildProcess("/no/such/program"),std::exception);
+
+    ChildProcess::install(previous);
+    BOOST_TEST(fake->failures().empty());
+    BOOST_TEST((fake->started()==std::vector<std::string>{ "/no/such/grep ^42$", "/no/such/daemon" }));
+
+    // Real processes again
+    BOOST_TEST(ChildProcess("/bin/true").join()==0);
+}
+
+/*
+ * Test capturing output with a line index.
+ */
+BOOST_FIXTURE_TEST_CASE(lineindex,Fx) {
+
+    // Capture 100000 lines of different lengths
+    auto chld = ChildProcess("/usr/bin/seq",{ "1", "100000" },ChildProcess::OUT);
+    LineCapture cap;
+    auto out = chld.read_stdout(cap.sink());
+    out.get();
+    BOOST_TEST(chld.join()==0);
+
+    BOOST_TEST(cap.lines()==100000);
+    BOOST_TEST(cap.line(0)=="1");
+    BOOST_TEST(cap.line(9999)=="10000");
+    BOOST_TEST(cap.line(99999)=="100000");
+    BOOST_TEST(cap.lines(63,3)=="64\n65\n66\n");
+    BOOST_TEST(cap.lines(99998,5)=="99999\n100000\n");
+    BOOST_CHECK_THROW(cap.line(100000),std::exception);
+    BOOST_TEST(cap.index().memory()<cap.lines()*2);    // vs. 8 bytes per line for plain offsets
+    BOOST_TEST(chld.io_stats().bytes_read==cap.index().bytes());
+
+    // Chunks that split lines, empty lines, no trailing newline
+    LineIndex idx;
+    for(auto chunk : { "ab", "c\n\nde", "f\ng" }) idx.add(chunk);
+    BOOST_TEST(idx.lines()==4);
+    BOOST_TEST((idx.range(0)==std::pair<uint64_t,uint64_t>(0,3)));
+    BOOST_TEST((idx.range(1)==std::pair<uint64_t,uint64_t>(4,4)));
+    BOOST_TEST((idx.range(2)==std::pair<uint64_t,uint64_t>(5,8)));
+    BOOST_TEST((idx.range(3)==std::pair<uint64_t,uint64_t>(9,10)));
+}
+
+/*
+ * Test writing the output of many processes into one job log.
+ */
+BOOST_FIXTURE_TEST_CASE(joblog,Fx) {
+
+    // Small segments, so the log rotates
+    {
+        JobLog log(tmpfile,8192);
+        std::vector<ChildProcess> chld;
+        std::vector<std::future<void>> io;
+        for(uint32_t job=0;job<8;++job) {
+            chld.emplace_back("/usr/bin/seq",std::vector<std::string>{ std::to_string(job), "3000" },ChildProcess::OUT);
+            io.push_back(chld.back().read_stdout(log.sink(job,JobLog::STDOUT)));
+        }
+        log.append(100,JobLog::STDERR,std::string(20000,'x'));    // Larger than a segment
+        for(auto& f : io) f.get();
+        for(auto& c : chld) BOOST_TEST(c.join()==0);
+        BOOST_TEST(log.segments()>10);
+    }
+
+    // Get each job's output back
+    const JobLogReader reader(tmpfile);
+    for(uint32_t job=0;job<8;++job) {
+        std::string expected;
+        for(auto i=job;i<=3000;++i) expected += std::to_string(i) + "\n";
+        BOOST_TEST(reader.extract(job,JobLog::STDOUT)==expected);
+    }
+    BOOST_TEST(reader.extract(100,JobLog::STDERR)==std::string(20000,'x'));
+    BOOST_TEST(reader.extract(100,JobLog::STDOUT).empty());
+
+    size_t records = 0;
+    reader.scan([&records](const JobLogReader::Record& r) {
+        BOOST_TEST(!r.data.empty());
+        BOOST_TEST(r.time.time_since_epoch().count()>0);
+        ++records;
+    });
+    BOOST_TEST(records>=11);
+
+    // A new log in the same directory continues after the existing segments
+    JobLog(tmpfile,8192).append(200,JobLog::STDOUT,"more\n");
+    BOOST_TEST(JobLogReader(tmpfile).extract(200,JobLog::STDOUT)=="more\n");
+    std::filesystem::remove_all(tmpfile);
+
+    // A record that was reserved but never published is skipped
+    {
+        JobLog log(tmpfile,8192);
+        for(auto data : { "lost\n", "kept\n", "too\n" }) log.append(300,JobLog::STDOUT,data);
+    }
+    {
+        std::fstream seg(tmpfile + "/segment-000000.log",std::ios::in | std::ios::out | std::ios::binary);
+        seg.seekp(16);
+        seg.write("\0\0\0\0",4);
+    }
+    BOOST_TEST(JobLogReader(tmpfile).extract(300,JobLog::STDOUT)=="kept\ntoo\n");
+
+    std::filesystem::remove_all(tmpfile);
+}
+
+/*
+ * Test reading JSON lines from a process.
+ */
+BOOST_FIXTURE_TEST_CASE(ndjson,Fx) {
+
+    // Many records, so some span chunks
+    auto chld = ChildProcess("/usr/bin/seq",{ "-f", R"({"id":%g,"nested":{"a":[1,"]"]},"s":"x\"y"})", "1", "20000" },ChildProcess::OUT);
+    auto count = 0;
+    auto sum = 0L;
+    auto out = chld.read_stdout(NdjsonSplitter([&](std::string_view record) {
+        ++count;
+        sum += std::stol(std::string(*JsonTokenizer::member(record,"id")));
+        BOOST_TEST(*JsonTokenizer::member(record,"s")==R"(x\"y)");
+        BOOST_TEST(*JsonTokenizer::member(record,"nested")==R"({"a":[1,"]"]})");
+        BOOST_TEST(!JsonTokenizer::member(record,"a"));
+    }));
+    out.get();
+    BOOST_TEST(chld.join()==0);
+    BOOST_TEST(count==20000);
+    BOOST_TEST(sum==20000L*20001/2);
+
+    // Chunk boundaries, blank lines, CRLF, no final newline
+    std::vector<std::string> records;
+    NdjsonSplitter split([&records](std::string_view r){ records.emplace_back(r); });
+    for(auto chunk : { "[1]\n{\"a\"", ":2}\r\n\n  \n", "\"last\"", "" }) split(chunk);
+    BOOST_TEST((records==std::vector<std::string>{ "[1]", "{\"a\":2}", "\"last\"" }));
+
+    // Tokens
+    JsonTokenizer tok(R"({"k":[true,false,null,-1.5e3,"\u00e9\ud83d\ude00"]})");
+    std::vector<JsonTokenizer::Type> types;
+    std::string text;
+    for(auto t=tok.next();t.type!=JsonTokenizer::END;t=tok.next()) {
+        types.push_back(t.type);
+        if (t.type==JsonTokenizer::STRING) text = JsonTokenizer::unescape(t.text);
+    }
+    BOOST_TEST((types==std::vector<JsonTokenizer::Type>{
+        JsonTokenizer::BEGIN_OBJECT, JsonTokenizer::KEY, JsonTokenizer::BEGIN_ARRAY,
+        JsonTokenizer::TRUE, JsonTokenizer::FALSE, JsonTokenizer::NUL, JsonTokenizer::NUMBER, JsonTokenizer::STRING,
+        JsonTokenizer::END_ARRAY, JsonTokenizer::END_OBJECT
+    }));
+    BOOST_TEST(text=="\xc3\xa9\xf0\x9f\x98\x80");
+    BOOST_TEST(JsonTokenizer::unescape(R"(\u00C9\uD83D\uDE00)")=="\xc3\x89\xf0\x9f\x98\x80");
+    for(auto bad : { R"(\u12zz)", R"(\u+123)", R"(\u 123)", R"(\u12)", R"(\ud83d\u0041)", R"(\ud83dx)", R"(\ude00)" }) {
+        BOOST_CHECK_THROW(JsonTokenizer::unescape(bad),std::exception);
+    }
+    BOOST_CHECK_THROW(JsonTokenizer::member(R"({"a":[1})","b"),std::exception);
+}
+
+/*
+ * Test detecting hung processes by their heartbeat.
+ */
+BOOST_FIXTURE_TEST_CASE(heartbeat,Fx) {
+
+    // A process that beats, with its own environment
+    const auto workload = (std::filesystem::read_symlink("/proc/self/exe").parent_path() / "childprocess-workload").string();
+    auto beating = ChildProcess(workload,{ "--heartbeat=10", "--exit-delay=5000" },ChildProcess::HEARTBEAT,
+        [](){ Heartbeat::beat(); },
+        EnvBlock(EnvBlock(),{{ "TEST", "1" }})
+    );
+    for(auto i=0;i<200 && beating.beats()<3;++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_TEST(*beating.beats()>=3);
+
+    // A process that doesn't
+    auto hung = ChildProcess("/bin/sleep",{ "30" },ChildProcess::HEARTBEAT);
+    const auto pid = hung.pid();
+    BOOST_TEST(*hung.beats()==0);
+    BOOST_TEST(!ChildProcess("/bin/true").beats());
+
+    // Each process only has its own counter
+    auto memfds = 0;
+    for(const auto& fd : std::filesystem::directory_iterator("/proc/" + std::to_string(pid) + "/fd")) {
+        if (std::filesystem::read_symlink(fd).string().find("childprocess-heartbeat")!=std::string::npos) {
+            BOOST_TEST(std::filesystem::file_size(fd)==size_t(sysconf(_SC_PAGESIZE)));
+            ++memfds;
+        }
+    }
+    BOOST_TEST(memfds==1);
+
+    // Watch only the heartbeats, and terminate the hung process
+    std::mutex mutex;
+    std::vector<std::pair<pid_t,unsigned>> stalls;
+    ProcessMonitor mon(std::chrono::milliseconds(20),0);
+    mon.on_stall(std::chrono::milliseconds(200),[&](pid_t p,unsigned n){
+        {
+            std::lock_guard<std::mutex> _(mutex);
+            stalls.emplace_back(p,n);
+        }
+        ProcessMonitor::terminate_process()(p,n);
+    });
+
+    const auto status = hung.join();
+    BOOST_TEST(WIFSIGNALED(status));
+    BOOST_TEST(WTERMSIG(status)==SIGTERM);
+    BOOST_TEST(!hung.beats());
+    BOOST_TEST(mon.series(pid).empty());
+
+    std::lock_guard<std::mutex> _(mutex);
+    BOOST_TEST((stalls==std::vector<std::pair<pid_t,unsigned>>{{ pid, 1 }}));
+}
+
+/*
+ * Test pulling the input from a range or a generator function.
+ */
+BOOST_FIXTURE_TEST_CASE(pump,Fx) {
+
+    // From a range
+    {
+        auto chld = ChildProcess("/usr/bin/sort",{},ChildProcess::IN | ChildProcess::OUT);
+        std::string sorted;
+        chld.pump(
+            ChildProcess::from_range(std::vector<std::string>{ "c\n", "a\n", "b\n" }),
+            [&sorted](std::string_view chunk){ sorted.append(chunk); }
+        );
+        BOOST_TEST(chld.join()==0);
+        BOOST_TEST(sorted=="a\nb\nc\n");
+    }
+
+    // Elements returned by value
+    {
+        const std::vector<int> numbers{ 1, 2, 3 };
+        struct Range {
+            const std::vector<int>* v;
+            struct It {
+                std::vector<int>::const_iterator i;
+                std::string operator*() const { return std::to_string(*i) + "\n"; }
+                It& operator++() { ++i; return *this; }
+                bool operator==(const It& o) const { return i==o.i; }
+            };
+            It begin() const { return { v->begin() }; }
+            It end() const { return { v->end() }; }
+        };
+        auto chld = ChildProcess("/bin/cat",{},ChildProcess::IN | ChildProcess::OUT);
+        std::string out;
+        chld.pump(ChildProcess::from_range(Range{ &numbers }),[&out](std::string_view chunk){ out.append(chunk); });
+        BOOST_TEST(chld.join()==0);
+        BOOST_TEST(out=="1\n2\n3\n");
+    }
+
+    // From a generator, much more than fits into the pipe, with stderr
+    {
+        const auto threads = ChildProcess::stats().io_threads.load();
+        auto chld = ChildProcess("/bin/sh",{ "-c", "wc -c; echo done >&2" },ChildProcess::IN | ChildProcess::OUT | ChildProcess::ERR);
+        const auto block = std::string(4096,'x');
+        auto blocks = 0;
+        std::string out, err;
+        chld.pump(
+            [&]() -> std::optional<std::string_view> {
+                BOOST_TEST(ChildProcess::stats().io_threads==threads);
+                if (blocks==1000) return std::nullopt;
+                ++blocks;
+                return std::string_view(block);
+            },
+            [&out](std::string_view chunk){ out.append(chunk); },
+            [&err](std::string_view chunk){ err.append(chunk); }
+        );
+        BOOST_TEST(chld.join()==0);
+        BOOST_TEST(std::stoul(out)==4096000);
+        BOOST_TEST(err=="done\n");
+        BOOST_TEST(chld.io_stats().bytes_written==4096000);
+    }
+
+    // Asking for a pipe that wasn't set up doesn't leak those taken before
+    {
+        const auto open_fds = [](){
+            const std::filesystem::directory_iterator it("/proc/self/fd");
+            return std::distance(begin(it),end(it));
+        };
+        auto chld = ChildProcess("/bin/cat",{},ChildProcess::IN);
+        const auto before = open_fds();
+        BOOST_CHECK_THROW(chld.pump(ChildProcess::from_range(std::vector<std::string>{ "x\n" }),[](std::string_view){}),std::exception);
+        BOOST_REQUIRE(open_fds()==before-1);
+        BOOST_TEST(chld.join()==0);
+    }
+}
+
+/*
+ * Test writing into a process that stops reading.
+ */
+BOOST_FIXTURE_TEST_CASE(epipe,Fx) {
+
+    // The stream function is aborted, without SIGPIPE
+    {
+        auto chld = ChildProcess("/usr/bin/head",{ "-n", "1" },ChildProcess::IN | ChildProcess::OUT);
+        auto lines = 0;
+        auto in = chld.make_stdin([&lines](std::ostream& os){
+            for(;;) {
+                os << "line " << lines++ << "\n";
+            }
+        });
+        std::string out;
+        auto rd = chld.read_stdout([&out](std::string_view chunk){ out.append(chunk); });
+        in.get();
+        rd.get();
+        BOOST_TEST(chld.join()==0);
+        BOOST_TEST(out=="line 0\n");
+        BOOST_TEST(chld.io_stats().epipes==1);
+        BOOST_TEST(lines<1000000);
+    }
+
+    // The producer isn't called any more
+    {
+        auto chld = ChildProcess("/usr/bin/head",{ "-c", "10" },ChildProcess::IN | ChildProcess::OUT);
+        const auto block = std::string(4096,'x');
+        auto blocks = 0;
+        std::string out;
+        chld.pump(
+            [&]() -> std::optional<std::string_view> { ++blocks; return std::string_view(block); },
+            [&out](std::string_view chunk){ out.append(chunk); }
+        );
+        BOOST_TEST(chld.join()==0);
+        BOOST_TEST(out==block.substr(0,10));
+        BOOST_TEST(blocks<1000);
+    }
+
+    // Other errors are still reported
+    {
+        auto chld = ChildProcess("/bin/true",{},ChildProcess::IN);
+        auto in = chld.make_stdin([](std::ostream&){ throw std::runtime_error("Test"); });
+        BOOST_CHECK_THROW(in.get(),std::runtime_error);
+    }
+}
+
+/*
+ * Test cleaning up output: UTF-8 repair and escape sequence removal.
+ */
+BOOST_FIXTURE_TEST_CASE(textfilter,Fx) {
+
+    // Through a pipe
+    auto chld = ChildProcess("/usr/bin/printf",{ R"(\033[1;32mok\033[0m \377\n)" },ChildProcess::OUT);
+    std::string out;
+    auto rd = chld.read_stdout(TextFilter([&out](std::string_view chunk){ out.append(chunk); }));
+    rd.get();
+    BOOST_TEST(chld.join()==0);
+    BOOST_TEST(out=="ok \xef\xbf\xbd\n");
+
+    // Escape sequences
+    BOOST_TEST(TextFilter::clean("plain text")=="plain text");
+    BOOST_TEST(TextFilter::clean("\x1b[1;31mred\x1b[0m, \x1b[2Kline")=="red, line");
+    BOOST_TEST(TextFilter::clean("\x1b]0;title\x07text\x1b]2;t\x1b\\ more")=="text more");
+    BOOST_TEST(TextFilter::clean("\x1b(Bx\x1b" "7y")=="xy");
+    BOOST_TEST(TextFilter::clean("\x1b[31\nx")=="\nx");
+
+    // UTF-8
+    const auto bad = std::string("\xef\xbf\xbd");
+    BOOST_TEST(TextFilter::clean("caf\xc3\xa9 \xf0\x9f\x98\x80")=="caf\xc3\xa9 \xf0\x9f\x98\x80");
+    BOOST_TEST(TextFilter::clean("a\xff" "b")=="a" + bad + "b");
+    BOOST_TEST(TextFilter::clean("\xe2\x82x")==bad + "x");
+    BOOST_TEST(TextFilter::clean("\xed\xa0\x80")==bad + bad + bad);
+    BOOST_TEST(TextFilter::clean("\xc0\xaf")==bad + bad);
+    BOOST_TEST(TextFilter::clean("end\xf0\x9f\x98")=="end" + bad);
+    BOOST_TEST(TextFilter::clean("\xc3\xa9\xc3\xa9\xff\xc3\xa9")=="\xc3\xa9\xc3\xa9" + bad + "\xc3\xa9");
+    BOOST_TEST(TextFilter::clean("\xe0\x80\x80\xf4\x90\x80\x80")==bad + bad + bad + bad + bad + bad + bad);
+
+    // Options
+    BOOST_TEST(TextFilter::clean("\x1b[1m\xff",TextFilter::ANSI)=="\xff");
+    BOOST_TEST(TextFilter::clean("\x1b[1m\xff",TextFilter::UTF8)=="\x1b[1m" + bad);
+
+    // Long chunks take the vectorized paths, single bytes don't
+    const char* valid[] = { "ascii text ", "\xc3\xa9", "\xe5\xa4\x84", "\xf0\x9f\x98\x80", "\xef\xbf\xbf", "\xf4\x8f\xbf\xbf",
+        "\x1b[1;31m", "\x1b]0;a title that is longer than a block\x07", "\x1bP\x1b\\" };
+    const char* invalid[] = { "\xff", "\xc0\xaf", "\xc1\xbf", "\xed\xa0\x80", "\xe0\x9f\xbf", "\xf0\x8f\xbf\xbf", "\xf4\x90\x80\x80",
+        "\xf5\x80", "\x80", "\xe2\x82", "\xf0\x9f", "\x1b[3\xc3\xa9" };
+    for(auto round=0;round<40;++round) {
+        std::string text;
+        while(text.size()<4000) {
+            text += rand()%(round%2 ? 4 : 100) ? valid[rand()%std::size(valid)] : invalid[rand()%std::size(invalid)];
+        }
+        std::string bytewise;
+        TextFilter filter([&bytewise](std::string_view chunk){ bytewise.append(chunk); });
+        for(const auto& c : text) filter(std::string_view(&c,1));
+        filter(std::string_view());
+        BOOST_TEST(TextFilter::clean(text)==bytewise);
+    }
+
+    // Sequences across chunks; clean chunks aren't copied
+    std::string result;
+    const char* passed = nullptr;
+    TextFilter filter([&](std::string_view chunk){ result.append(chunk); passed = chunk.data(); });
+    const std::string clean = "clean chunk of more than sixteen bytes";
+    filter(clean);
+    BOOST_TEST(passed==clean.data());
+    const std::string utf8 = "\xd0\x97\xd0\xb0 \xe5\xa4\x84 \xf0\x9f\x98\x80 caf\xc3\xa9";
+    filter(utf8);
+    BOOST_TEST(passed==utf8.data());
+    result.clear();
+    for(auto chunk : { "a\xc3", "\xa9" "b\x1b[3", "1mc\x1b]0;", "x\x07" "d", "" }) filter(chunk);
+    BOOST_TEST(result=="a\xc3\xa9" "bcd");
+}
+
+/*
+ * Test pausing and resuming processes.
+ */
+BOOST_FIXTURE_TEST_CASE(pause,Fx) {
+    const auto workload = (std::filesystem::read_symlink("/proc/self/exe").parent_path() / "childprocess-workload").string();
+    const auto running = [](const ChildProcess& chld,int tries=200){
+        const auto before = *chld.beats();
+        for(auto i=0;i<tries && chld.beats()==before;++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return chld.beats()!=before;
+    };
+
+    // Single process
+    auto chld = ChildProcess(workload,{ "--heartbeat=5", "--exit-delay=30000" },ChildProcess::HEARTBEAT | ChildProcess::PGROUP);
+    BOOST_TEST(running(chld));
+    BOOST_TEST(chld.pause());
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    BOOST_TEST(!running(chld,20));
+    BOOST_TEST(chld.resume());
+    BOOST_TEST(running(chld));
+    BOOST_TEST(chld.pause());
+
+    // Groups, with the cgroup freezer if possible, and with signals
+    for(auto mode : { JobGroup::AUTO, JobGroup::SIGNALS }) {
+        JobGroup group(mode);
+        BOOST_TEST(group.mode()!=JobGroup::AUTO);
+        auto a = group.start(workload,{ "--heartbeat=5", "--exit-delay=30000" },ChildProcess::HEARTBEAT);
+        auto b = group.start(workload,{ "--heartbeat=5", "--exit-delay=30000" },ChildProcess::HEARTBEAT);
+        BOOST_TEST(running(a));
+        BOOST_TEST(running(b));
+        if (group.mode()==JobGroup::CGROUP) {
+            std::ifstream procs(group.cgroup() + "/cgroup.procs");
+            BOOST_TEST(std::distance(std::istream_iterator<std::string>(procs),std::istream_iterator<std::string>())==2);
+        }
+
+        const auto latency = group.pause();
+        BOOST_TEST(group.paused());
+        BOOST_TEST(latency.count()<1000000000);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        BOOST_TEST(!running(a,20));
+        BOOST_TEST(!running(b,20));
+
+        group.resume();
+        BOOST_TEST(running(a));
+        BOOST_TEST(running(b));
+    }
+
+    // Destroying a group leader kills what's left of its group, including
+    // descendants that ignore SIGTERM
+    pid_t grandchild = 0;
+    {
+        ChildProcess leader("/bin/sh",{ "-c", R"(sh -c 'trap "" TERM; echo $$; exec sleep 60' & wait)" },ChildProcess::OUT | ChildProcess::PGROUP);
+        leader.get_stdout([&grandchild](std::istream& is){ is >> grandchild; }).get();
+    }
+    BOOST_TEST(grandchild>0);
+    const auto alive = [](pid_t pid){
+        std::ifstream ifs("/proc/" + std::to_string(pid) + "/stat");
+        std::string skip;
+        char state = 'X';
+        ifs >> skip >> skip >> state;
+        return ifs && state!='Z';
+    };
+    for(auto i=0;i<200 && alive(grandchild);++i) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    BOOST_TEST(!alive(grandchild));
+}
+
+/*
+ * Test forking pre-initialized copies of a template worker.
+ */
+BOOST_FIXTURE_TEST_CASE(templateworker,Fx) {
+    const auto workload = (std::filesystem::read_symlink("/proc/self/exe").parent_path() / "childprocess-workload").string();
+    auto worker = TemplateWorker::start(workload,{ "--init=300", "--template", "--echo", "--exit=3" });
+
+    // The first copy waits for the initialization, the others don't
+    std::vector<ChildProcess> copies;
+    for(auto i=0;i<3;++i) {
+        const auto start = std::chrono::steady_clock::now();
+        copies.push_back(worker->fork(ChildProcess::IN | ChildProcess::OUT));
+        if (i>0) BOOST_TEST((std::chrono::steady_clock::now()-start<std::chrono::milliseconds(200)));
+    }
+
+    // Each copy has its own pipes and exit status
+    for(size_t i=0;i<copies.size();++i) {
+        auto& chld = copies[i];
+        BOOST_TEST(chld.pid()!=worker->pid());
+        auto in = chld.make_stdin([i](std::ostream& os){ os << "copy " << i << "\n"; });
+        std::string out;
+        chld.get_stdout([&](std::istream& is){ std::getline(is,out); }).get();
+        in.get();
+        BOOST_TEST(out=="copy " + std::to_string(i));
+        const auto status = chld.join();
+        BOOST_TEST(WIFEXITED(status));
+        BOOST_TEST(WEXITSTATUS(status)==3);
+    }
+
+    // Signals are forwarded; the dtor terminates running copies
+    auto running = worker->fork(ChildProcess::IN);
+    BOOST_TEST(ChildProcess(worker->fork(ChildProcess::IN)).pid()>0);
+    running.pause();
+    running.resume();
+
+    // Without the template, the worker program works normally
+    auto direct = ChildProcess(workload,{ "--template", "--exit=4" });
+    BOOST_TEST(WEXITSTATUS(direct.join())==4);
+}
+
+/*
+ * Test capturing output into rotating files.
+ */
+BOOST_FIXTURE_TEST_CASE(rotatingfile,Fx) {
+    const auto workload = (std::filesystem::read_symlink("/proc/self/exe").parent_path() / "childprocess-workload").string();
+    std::filesystem::create_directory(tmpfile);
+    const auto path = tmpfile + "/out.log";
+    const auto contents = [](const std::string& name){
+        std::ifstream ifs(name,std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(ifs),std::istreambuf_iterator<char>());
+    };
+
+    // By size, with stdout and stderr in the same file
+    {
+        auto file = std::make_shared<RotatingFile>(path,10000);
+        ChildProcess chld(workload,{ "--emit=30000", "--line=100", "--chunk=4096" },ChildProcess::OUT);
+        ChildProcess err(workload,{ "--emit=5000", "--stderr" },ChildProcess::ERR);
+        auto out = chld.splice_stdout(file);
+        auto errout = err.splice_stderr(file);
+        out.get();
+        errout.get();
+        BOOST_TEST(chld.join()==0);
+        BOOST_TEST(err.join()==0);
+        BOOST_TEST(chld.io_stats().bytes_read==30000U);
+
+        const auto segs = file->segments();
+        BOOST_TEST(segs.size()==3U);
+        BOOST_TEST(file->size()==5000U);
+        for(const auto& seg : segs) BOOST_TEST(std::filesystem::file_size(seg)==10000U);
+        BOOST_TEST(segs.back()==path + ".3");
+    }
+
+    // Continuing a file that's already larger than the limit rotates it first
+    {
+        const auto full = tmpfile + "/full.log";
+        std::ofstream(full) << std::string(12000,'x');
+        auto file = std::make_shared<RotatingFile>(full,10000);
+        ChildProcess chld(workload,{ "--emit=3000" },ChildProcess::OUT);
+        chld.splice_stdout(file).get();
+        BOOST_TEST(chld.join()==0);
+        BOOST_TEST((file->segments()==std::vector<std::string>{ full + ".1" }));
+        BOOST_TEST(std::filesystem::file_size(full + ".1")==12000U);
+        BOOST_TEST(file->size()==3000U);
+    }
+
+    // Numbering continues; by age, compressed
+    {
+        auto file = std::make_shared<RotatingFile>(path,0,std::chrono::milliseconds(100),true);
+        BOOST_TEST(file->size()==5000U);
+        ChildProcess chld(workload,{ "--emit=4000", "--chunk=100", "--rate=10000" },ChildProcess::OUT);
+        chld.splice_stdout(file).get();
+        BOOST_TEST(chld.join()==0);
+        file->rotate();
+        file->wait();
+
+        const auto segs = file->segments();
+        BOOST_TEST(segs.size()>=3U);
+        BOOST_TEST(segs.front()==path + ".4.gz");
+        std::string all;
+        for(const auto& seg : segs) {
+            auto gunzip = ChildProcess("/bin/gzip",{ "-dc", seg },ChildProcess::OUT);
+            gunzip.get_stdout([&](std::istream& is){ all += std::string(std::istreambuf_iterator<char>(is),{}); }).get();
+            BOOST_TEST(gunzip.join()==0);
+        }
+        BOOST_TEST(all.size()==9000U);
+        BOOST_TEST(contents(path).empty());
+    }
+    std::filesystem::remove_all(tmpfile);
+}
+
+/*
+ * Test limiting the line rate of output.
+ */
+BOOST_FIXTURE_TEST_CASE(linelimiter,Fx) {
+    const auto workload = (std::filesystem::read_symlink("/proc/self/exe").parent_path() / "childprocess-workload").string();
+
+    // A flood of 10000 lines: the first 100 and every 1000th after them are kept
+    std::string out;
+    LineLimiter limit([&](std::string_view chunk){ out.append(chunk); },100,std::chrono::seconds(60),1000);
+    ChildProcess chld(workload,{ "--emit=100000", "--line=10", "--stderr" },ChildProcess::ERR);
+    chld.read_stderr(limit.sink()).get();
+    BOOST_TEST(chld.join()==0);
+    BOOST_TEST(limit.passed()==109U);
+    BOOST_TEST(limit.suppressed()==9891U);
+    BOOST_TEST(out.size()==109*10U + std::string("[9891 lines suppressed]\n").size());
+    BOOST_TEST(out.substr(1090)=="[9891 lines suppressed]\n");
+
+    // Intervals, lines across chunks; kept runs aren't copied
+    out.clear();
+    std::vector<const char*> passed;
+    LineLimiter lines([&](std::string_view chunk){ out.append(chunk); passed.push_back(chunk.data()); },2,std::chrono::milliseconds(50));
+    const std::string first = "a\nb\nc\nd\ne";
+    lines(first);
+    BOOST_TEST(passed.front()==first.data());
+    lines("e\nf\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    lines("g\nh");
+    lines("h\ni\nj");
+    lines("");
+    BOOST_TEST(out=="a\nb\n[4 lines suppressed]\ng\nhh\n[2 lines suppressed]\n");
+    BOOST_TEST(lines.passed()==4U);
+    BOOST_TEST(lines.suppressed()==6U);
+}
+
+/*
+ * Test running jobs with scheduling policies, and simulating them.
+ */
+BOOST_FIXTURE_TEST_CASE(jobrunner,Fx) {
+    using ms = std::chrono::milliseconds;
+    const auto workload = (std::filesystem::read_symlink("/proc/self/exe").parent_path() / "childprocess-workload").string();
+
+    // Resource usage from wait4
+    ChildProcess burn(workload,{ "--burn=50" });
+    BOOST_TEST(!burn.usage().valid);
+    BOOST_TEST(burn.join()==0);
+    BOOST_TEST(burn.usage().valid);
+    BOOST_TEST((burn.usage().user+burn.usage().system).count()>=40000);
+    BOOST_TEST(burn.usage().max_rss>0U);
+
+    // Three jobs arriving at once, one slot
+    const auto job = [](const char* name,int prio,int dur,unsigned long long mem=0){
+        JobRunner::Record r;
+        r.name = name;
+        r.priority = prio;
+        r.memory = mem;
+        r.end = ms(dur);
+        return r;
+    };
+    const std::vector<JobRunner::Record> history = { job("long",0,100), job("short",1,10), job("mid",2,20) };
+    const auto starts = [](const std::vector<JobRunner::Record>& sched){
+        std::vector<long long> ret;
+        for(const auto& r : sched) ret.push_back(std::chrono::duration_cast<ms>(r.start).count());
+        return ret;
+    };
+
+    const auto fifo = JobRunner::simulate(history,{ JobRunner::FIFO, 1 });
+    BOOST_TEST((starts(fifo)==std::vector<long long>{ 0, 100, 110 }));
+    const auto sjf = JobRunner::simulate(history,{ JobRunner::SJF, 1 });
+    BOOST_TEST((starts(sjf)==std::vector<long long>{ 30, 0, 10 }));
+    const auto prio = JobRunner::simulate(history,{ JobRunner::PRIORITY, 1 });
+    BOOST_TEST((starts(prio)==std::vector<long long>{ 30, 20, 0 }));
+
+    const auto rf = JobRunner::report(fifo,1), rs = JobRunner::report(sjf,1);
+    BOOST_TEST(rf.makespan.count()==130000);
+    BOOST_TEST(rs.makespan.count()==130000);
+    BOOST_TEST(rf.mean_wait.count()==70000);
+    BOOST_TEST(rs.mean_wait.count()==13333);
+    BOOST_TEST(rf.utilization==1.0);
+    BOOST_TEST(JobRunner::report(JobRunner::simulate(history,{ JobRunner::FIFO, 3 }),3).makespan.count()==100000);
+
+    // Memory budget: two slots, but only one of the big jobs fits at a time
+    const std::vector<JobRunner::Record> big = { job("a",0,50,60), job("b",0,50,60), job("c",0,50,30) };
+    BOOST_TEST((starts(JobRunner::simulate(big,{ JobRunner::FIFO, 2, 100 }))==std::vector<long long>{ 0, 50, 50 }));
+
+    // Real jobs, recorded, saved, loaded, and replayed
+    JobRunner runner({ JobRunner::FIFO, 2 });
+    for(auto i=0;i<4;++i) {
+        runner.submit({ "sleep" + std::to_string(i), workload, { "--exit-delay=100" }, 0, ms(100), 0, ms(i*10) });
+    }
+    runner.submit({ "missing", "/nonexistent", {}, 0, ms(0), 0, ms(0) });
+    const auto recorded = runner.run();
+    BOOST_TEST(recorded.size()==5U);
+    for(auto i=0;i<4;++i) {
+        BOOST_TEST(recorded[i].status==0);
+        BOOST_TEST(recorded[i].wait().count()>=0);
+        BOOST_TEST(recorded[i].duration().count()>=100000);
+        BOOST_TEST(recorded[i].max_rss>0U);
+    }
+    BOOST_TEST(recorded[4].status==-1);
+
+    JobRunner::save(tmpfile,recorded);
+    const auto loaded = JobRunner::load(tmpfile);
+    BOOST_TEST(loaded.size()==recorded.size());
+    BOOST_TEST(loaded[2].name=="sleep2");
+    BOOST_TEST(loaded[2].end.count()==recorded[2].end.count());
+    BOOST_TEST(loaded[3].max_rss==recorded[3].max_rss);
+
+    const auto real = JobRunner::report(recorded,2);
+    const auto sim = JobRunner::report(JobRunner::simulate(loaded,{ JobRunner::FIFO, 2 }),2);
+    BOOST_TEST(real.makespan.count()>=200000);
+    BOOST_TEST(std::abs(double(sim.makespan.count())/real.makespan.count()-1)<0.2);
+    BOOST_TEST(sim.mean_wait.count()>0);
+}
+
+/*
+ * Test parsing a command line without a shell.
+ */
+BOOST_FIXTURE_TEST_CASE(parse,Fx) {
+
+    const auto cmds = Pipeline::parse(
+        R"(A=1 B='x y' sort -k "2 3" a\ b <in 2>&1 | uniq >>out)"
+    );
+
+    BOOST_TEST(cmds.size()==2);
+    BOOST_TEST(cmds[0].env.size()==2);
+    BOOST_TEST(cmds[0].env[1].second=="x y");
+    BOOST_TEST((cmds[0].argv==std::vector<std::string>{ "sort", "-k", "2 3", "a b" }));
+    BOOST_TEST(cmds[0].redirects.size()==2);
+    BOOST_TEST(cmds[0].redirects[0].fd==0);
+    BOOST_TEST(cmds[0].redirects[0].file=="in");
+    BOOST_TEST(cmds[0].redirects[1].fd==2);
+    BOOST_TEST(cmds[0].redirects[1].dupfd==1);
+    BOOST_TEST((cmds[1].argv==std::vector<std::string>{ "uniq" }));
+    BOOST_TEST(cmds[1].redirects[0].fd==1);
+    BOOST_TEST(cmds[1].redirects[0].file=="out");
+
+    // Things a shell would expand must be rejected
+    BOOST_CHECK_THROW(Pipeline::parse("echo $HOME"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("ls *.cpp"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("true; false"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("echo | | cat"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("echo 'unterminated"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("touch file{a,b}"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("seq {1..3}"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("PATH=~/bin ls"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("env PATH=/bin:~/bin ls"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("echo a\nrm b"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("echo a\n"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("echo 99999999999>f"),std::exception);
+    BOOST_CHECK_THROW(Pipeline::parse("echo 2>&99999999999"),std::exception);
+    BOOST_TEST((Pipeline::parse("echo 'a\nb' \"c\nd\" e\\\nf")[0].argv==std::vector<std::string>{ "echo", "a\nb", "c\nd", "ef" }));
+    BOOST_TEST(Pipeline::parse("echo 2147483647>f")[0].redirects[0].fd==2147483647);
+    BOOST_TEST((Pipeline::parse("find . -exec rm {} +")[0].argv[4]=="{}"));
+    BOOST_TEST((Pipeline::parse("scp f host:~/x")[0].argv[2]=="host:~/x"));
+    BOOST_TEST((Pipeline::parse("echo '{a,b}' X='=~'")[0].argv==std::vector<std::string>{ "echo", "{a,b}", "X==~" }));
+}
+
+/*
+ * Test running a pipeline with redirections.
+ */
+BOOST_FIXTURE_TEST_CASE(pipeline,Fx) {
+
+    const auto data = std::to_string(rand());
+
+    // Write to a file through a pipe, with an environment assignment
+    auto p = Pipeline("VALUE=" + data + " printenv VALUE | cat >" + tmpfile);
+    BOOST_TEST(p.join()==0);
+
+    // Read it back, via stdin redirection and our stdout pipe
+    auto q = Pipeline("cat <" + tmpfile + " 2>&1 | tr 0-9 a-j",ChildProcess::OUT);
+    std::string output;
+    q.get_stdout([&output](std::istream& is){ std::getline(is,output); }).get();
+    BOOST_TEST(q.join()==0);
+
+    auto expected = data;
+    for(auto& c : expected) c = c - '0' + 'a';
+    BOOST_TEST(output==expected);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
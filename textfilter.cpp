@@ -0,0 +1,210 @@
+/**
+ * @brief Text cleanup filter implementation
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#include "simd.hpp"
+#include "textfilter.hpp"
+
+namespace {
+    /*
+     * Check a UTF-8 lead byte. Returns the length of the sequence it
+     * starts and the range of the second byte, or 0 if it can't start one.
+     */
+    int utf8_lead(unsigned char c,unsigned char& lower,unsigned char& upper) {
+        lower = 0x80;
+        upper = 0xbf;
+        if      (c>=0xc2 && c<=0xdf) { return 2; }
+        else if (c==0xe0)            { lower = 0xa0; return 3; }
+        else if (c>=0xe1 && c<=0xef) { if (c==0xed) upper = 0x9f; return 3; }
+        else if (c==0xf0)            { lower = 0x90; return 4; }
+        else if (c>=0xf1 && c<=0xf3) { return 4; }
+        else if (c==0xf4)            { upper = 0x8f; return 4; }
+        return 0;
+    }
+
+    /*
+     * Find the end of the text that needs no changes: plain ASCII and
+     * complete, valid UTF-8 sequences. Stops at an escape character, an
+     * invalid byte, or a sequence that continues in the next chunk.
+     */
+    const char* skip_valid(const char* p,const char* end) {
+        for(;;) {
+            // Plain ASCII up to an escape character
+            p = find_non_ascii_or_esc(p,end);
+            if (p==end || *p=='\x1b') return p;
+
+            // Byte by byte for a while, where sequences that need repairing
+            // are found right away
+            for(const auto limit=end-p>16 ? p+16 : end;p<limit;) {
+                const auto c = static_cast<unsigned char>(*p);
+                if (c==0x1b) return p;
+                if (c<0x80) {
+                    ++p;
+                    continue;
+                }
+                unsigned char lower, upper;
+                const auto need = utf8_lead(c,lower,upper);
+                if (!need || end-p<need) return p;
+                const auto second = static_cast<unsigned char>(p[1]);
+                if (second<lower || second>upper) return p;
+                for(int i=2;i<need;++i) {
+                    const auto next = static_cast<unsigned char>(p[i]);
+                    if (next<0x80 || next>0xbf) return p;
+                }
+                p += need;
+            }
+
+            // Then whole blocks at once
+            p = skip_valid_utf8(p,end);
+        }
+    }
+}
+
+/**
+ * Process the next chunk: pass on its cleaned-up contents.
+ */
+void TextFilter::operator()(std::string_view chunk) {
+
+    // End of stream: an incomplete UTF-8 sequence is invalid, an incomplete
+    // escape sequence is dropped
+    if (chunk.empty()) {
+        out_.clear();
+        if (state_==UTF8_SEQ) invalid();
+        state_ = GROUND;
+        if (!out_.empty()) next_(out_);
+        next_(chunk);
+        return;
+    }
+
+    auto p = chunk.data();
+    const auto end = p + chunk.size();
+
+    // Nothing to do: pass on the chunk as it is
+    const auto skip = [this](const char* p,const char* end) {
+        return options_ & UTF8 ? skip_valid(p,end) : find_non_ascii_or_esc(p,end);
+    };
+    if (state_==GROUND && skip(p,end)==end) {
+        next_(chunk);
+        return;
+    }
+
+    out_.clear();
+    out_.reserve(chunk.size());
+    while(p<end) {
+        if (state_==GROUND) {
+            const auto special = skip(p,end);
+            out_.append(p,special);
+            p = special;
+            if (p==end) break;
+        } else if (state_==STRING) {
+            // Skip the string up to its terminator
+            p = find_either(p,end,0x07,0x1b);
+            if (p==end) break;
+        } else if (state_==CSI) {
+            // Skip parameter and intermediate bytes
+            p = find_outside(p,end,0x20,0x3f);
+            if (p==end) break;
+        }
+        feed(static_cast<unsigned char>(*p++));
+    }
+    if (!out_.empty()) next_(out_);
+}
+
+/**
+ * Clean up a complete text.
+ */
+std::string TextFilter::clean(std::string_view text,int options) {
+    std::string ret;
+    TextFilter filter([&ret](std::string_view chunk){ ret.append(chunk); },options);
+    filter(text);
+    filter(std::string_view());
+    return ret;
+}
+
+/*
+ * Process one byte outside of an ASCII run.
+ */
+void TextFilter::feed(unsigned char c) {
+    switch(state_) {
+        case GROUND:
+            if (c==0x1b && (options_ & ANSI)) {
+                state_ = ESC;
+            } else if (c<0x80 || !(options_ & UTF8)) {
+                out_ += static_cast<char>(c);
+            } else {
+                // Lead byte: sequence length and range of the second byte
+                need_ = utf8_lead(c,lower_,upper_);
+                if (!need_) {
+                    invalid();
+                    break;
+                }
+                seq_[0] = static_cast<char>(c);
+                len_ = 1;
+                state_ = UTF8_SEQ;
+            }
+            break;
+
+        case UTF8_SEQ:
+            if (c<lower_ || c>upper_) {
+                // The sequence so far is invalid; the byte starts something new
+                invalid();
+                state_ = GROUND;
+                feed(c);
+                break;
+            }
+            seq_[len_++] = static_cast<char>(c);
+            lower_ = 0x80;
+            upper_ = 0xbf;
+            if (len_==need_) {
+                out_.append(seq_,len_);
+                state_ = GROUND;
+            }
+            break;
+
+        case ESC:
+            if (c=='[') {
+                state_ = CSI;
+            } else if (c==']' || c=='P' || c=='X' || c=='^' || c=='_') {
+                state_ = STRING;
+            } else if (c>=0x20 && c<=0x2f) {
+                // Intermediate byte, stay
+            } else if (c>=0x30 && c<=0x7e) {
+                state_ = GROUND;
+            } else {
+                state_ = GROUND;
+                feed(c);
+            }
+            break;
+
+        case CSI:
+            if (c>=0x40 && c<=0x7e) {
+                state_ = GROUND;
+            } else if (c<0x20 || c>0x3f) {
+                // Malformed: drop what we have, keep the byte
+                state_ = GROUND;
+                feed(c);
+            }
+            break;
+
+        case STRING:
+            if (c==0x07) state_ = GROUND;
+            else if (c==0x1b) state_ = STRING_ESC;
+            break;
+
+        case STRING_ESC:
+            if (c=='\\') state_ = GROUND;
+            else if (c!=0x1b) state_ = STRING;
+            break;
+    }
+}
+
+/*
+ * Output the replacement character for an invalid sequence.
+ */
+void TextFilter::invalid() {
+    out_ += "\xef\xbf\xbd";
+}
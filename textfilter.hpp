@@ -0,0 +1,69 @@
+/**
+ * @brief Text cleanup filter header file
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "childprocess.hpp"
+
+/**
+ * Filter stage for ChildProcess::read_stdout and read_stderr that cleans
+ * up output while it's read:
+ *
+ *  - Invalid UTF-8 is replaced by U+FFFD, one per maximal invalid
+ *    subsequence (as recommended by the Unicode standard), and
+ *  - terminal escape sequences (CSI sequences like colors, OSC/DCS strings
+ *    like window titles, and other ESC sequences) are removed.
+ *
+ * Runs of plain ASCII are found 16 bytes at a time (SSE2), and runs of
+ * valid UTF-8 are validated 16 bytes at a time (SSSE3, if the CPU has it);
+ * the whole run is then copied at once, and a chunk that needs no changes
+ * is passed on without copying. The bodies of escape sequences (CSI
+ * parameters, OSC/DCS strings) are skipped 16 bytes at a time as well.
+ * Invalid bytes, the start and end of escape sequences, and sequences
+ * split across chunks go through a byte-wise state machine, so text with
+ * an escape sequence or invalid byte every few bytes is filtered at
+ * scalar speed.
+ *
+ *      auto out = chld.read_stdout(TextFilter([](std::string_view clean) {
+ *          ...
+ *      }));
+ */
+class TextFilter {
+public:
+    // What to do
+    enum Options {
+        UTF8 = 1<<0,                        ///< Validate and repair UTF-8
+        ANSI = 1<<1                         ///< Strip escape sequences
+    };
+
+    explicit TextFilter(ChildProcess::Chunk next,int options=UTF8 | ANSI)
+    : next_(std::move(next)), options_(options) {}
+
+    // Process the next chunk; an empty chunk means end of stream
+    void operator()(std::string_view chunk);
+
+    // Clean up a complete text
+    static std::string clean(std::string_view text,int options=UTF8 | ANSI);
+
+private:
+    enum State { GROUND, UTF8_SEQ, ESC, CSI, STRING, STRING_ESC };
+
+    ChildProcess::Chunk next_;
+    int options_;
+    std::string out_;                       // Cleaned chunk
+    State state_ = GROUND;
+    char seq_[4];                           // Incomplete UTF-8 sequence
+    int len_ = 0, need_ = 0;                // Its length so far, and total
+    unsigned char lower_ = 0, upper_ = 0;   // Range of the next byte
+
+    void feed(unsigned char c);
+    void invalid();
+};
@@ -0,0 +1,230 @@
+/**
+ * @brief Synthetic workload child process for benchmarks
+ * @version 1.0.0
+ * @author agent
+ * @date 2026-10-19
+ * @copyright MIT license
+ *
+ * A small program with reproducible behaviour, to be run as a child process
+ * by the benchmarks instead of host tools like /bin/cat. Usage:
+ *
+ *   childprocess-workload [options]
+ *
+ *   --init=MS           Sleep MS milliseconds at startup (simulated initialization)
+ *   --template          Serve as template worker after the initialization (see forkserver.hpp)
+ *   --emit=BYTES        Write BYTES bytes to stdout (-1: forever)
+ *   --consume           Read stdin until EOF and discard it
+ *   --echo              Copy stdin to stdout until EOF
+ *   --stderr            Write to stderr instead of stdout
+ *   --chunk=BYTES       Bytes per write/read (default 65536)
+ *   --line=BYTES        Line length including the newline (default 0: no newlines)
+ *   --rate=BYTES        Limit emitting, consuming, and echoing to BYTES bytes per second
+ *                       (default 0: unlimited)
+ *   --burn=MS           Burn MS milliseconds of CPU time before exiting
+ *   --exit-delay=MS     Sleep MS milliseconds before exiting
+ *   --exit=CODE         Exit status (default 0)
+ *   --sigterm=MODE      default, ignore, or slow:MS (exit MS milliseconds after SIGTERM)
+ *   --children=N        Start N grandchildren that sleep until killed
+ *   --ready             Print the grandchildren's PIDs and then "ready" on stdout,
+ *                       one per line, once the signal handling is set up
+ *   --heartbeat=MS      Call Heartbeat::beat() every MS milliseconds (see heartbeat.hpp)
+ *
+ * The actions are performed in this order: signal setup, initialization,
+ * template worker (the rest happens in each forked copy), grandchildren,
+ * ready message, heartbeat thread, emit/consume/echo, CPU burn, exit delay.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "forkserver.hpp"
+#include "heartbeat.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// Delay between SIGTERM and exit for --sigterm=slow:MS
+int slow_ms = 0;
+
+/*
+ * SIGTERM handler for --sigterm=slow.
+ */
+void slow_exit(int) {
+    usleep(slow_ms*1000);
+    _exit(EXIT_SUCCESS);
+}
+
+/*
+ * Write all of a buffer.
+ */
+bool write_all(int fd,const char* buf,size_t n) {
+    while(n>0) {
+        const auto ret = write(fd,buf,n);
+        if (ret<0) {
+            if (errno==EINTR) continue;
+            return false;
+        }
+        buf += ret;
+        n -= ret;
+    }
+    return true;
+}
+
+/*
+ * Sleep as needed so that `bytes` bytes haven't been written faster than `rate`.
+ */
+void throttle(Clock::time_point start,long long bytes,long long rate) {
+    if (rate<=0) return;
+    const auto due = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(double(bytes)/rate));
+    std::this_thread::sleep_until(due);
+}
+
+/*
+ * Burn CPU time.
+ */
+void burn(int ms) {
+    const auto end = Clock::now() + std::chrono::milliseconds(ms);
+    volatile unsigned long x = 0;
+    while(Clock::now()<end) {
+        for(auto i=0;i<10000;++i) x = x*31 + i;
+    }
+}
+
+} // namespace
+
+int main(int argc,char** argv) {
+    long long emit = 0, rate = 0;
+    size_t chunk = 65536, line = 0;
+    bool consume = false, echo = false, serve = false, ready = false;
+    int init_ms = 0, out = STDOUT_FILENO, burn_ms = 0, delay_ms = 0, status = 0, children = 0, beat_ms = 0;
+    std::string sigterm = "default";
+
+    static const option options[] = {
+        { "init",       required_argument, nullptr, 'i' },
+        { "template",   no_argument,       nullptr, 'T' },
+        { "emit",       required_argument, nullptr, 'e' },
+        { "consume",    no_argument,       nullptr, 'c' },
+        { "echo",       no_argument,       nullptr, 'E' },
+        { "stderr",     no_argument,       nullptr, '2' },
+        { "chunk",      required_argument, nullptr, 'k' },
+        { "line",       required_argument, nullptr, 'l' },
+        { "rate",       required_argument, nullptr, 'r' },
+        { "burn",       required_argument, nullptr, 'b' },
+        { "exit-delay", required_argument, nullptr, 'd' },
+        { "exit",       required_argument, nullptr, 'x' },
+        { "sigterm",    required_argument, nullptr, 't' },
+        { "children",   required_argument, nullptr, 'C' },
+        { "ready",      no_argument,       nullptr, 'R' },
+        { "heartbeat",  required_argument, nullptr, 'h' },
+        { nullptr,      0,                 nullptr, 0   }
+    };
+
+    for(int opt;(opt=getopt_long(argc,argv,"",options,nullptr))!=-1;) {
+        switch(opt) {
+            case 'i': init_ms  = std::atoi(optarg); break;
+            case 'T': serve    = true; break;
+            case 'e': emit     = std::atoll(optarg); break;
+            case 'c': consume  = true; break;
+            case 'E': echo     = true; break;
+            case '2': out      = STDERR_FILENO; break;
+            case 'k': chunk    = std::max(1LL,std::atoll(optarg)); break;
+            case 'l': line     = std::atoll(optarg); break;
+            case 'r': rate     = std::atoll(optarg); break;
+            case 'b': burn_ms  = std::atoi(optarg); break;
+            case 'd': delay_ms = std::atoi(optarg); break;
+            case 'x': status   = std::atoi(optarg); break;
+            case 't': sigterm  = optarg; break;
+            case 'C': children = std::atoi(optarg); break;
+            case 'R': ready    = true; break;
+            case 'h': beat_ms  = std::atoi(optarg); break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [--init=MS] [--template] [--emit=BYTES] [--consume] [--echo] [--stderr] [--chunk=BYTES]"
+                    " [--line=BYTES] [--rate=BYTES] [--burn=MS] [--exit-delay=MS] [--exit=CODE]"
+                    " [--sigterm=default|ignore|slow:MS] [--children=N] [--ready] [--heartbeat=MS]\n";
+                return EXIT_FAILURE;
+        }
+    }
+
+    // SIGTERM handling
+    if (sigterm=="ignore") {
+        signal(SIGTERM,SIG_IGN);
+    } else if (sigterm.compare(0,5,"slow:")==0) {
+        slow_ms = std::atoi(sigterm.c_str()+5);
+        signal(SIGTERM,slow_exit);
+    } else if (sigterm!="default") {
+        std::cerr << "Invalid --sigterm mode: " << sigterm << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // Expensive initialization, done once for all copies of a template worker
+    if (init_ms>0) std::this_thread::sleep_for(std::chrono::milliseconds(init_ms));
+    if (serve) ForkServer::serve();
+
+    // Grandchildren that live until they're killed
+    std::string report;
+    for(auto i=0;i<children;++i) {
+        const auto pid = fork();
+        if (pid==0) {
+            for(;;) pause();
+        }
+        report += std::to_string(pid) + "\n";
+    }
+    if (ready) {
+        report += "ready\n";
+        write_all(STDOUT_FILENO,report.data(),report.size());
+    }
+
+    // Heartbeat until exit
+    if (beat_ms>0) {
+        std::thread([beat_ms](){
+            for(;;) {
+                Heartbeat::beat();
+                std::this_thread::sleep_for(std::chrono::milliseconds(beat_ms));
+            }
+        }).detach();
+    }
+
+    // Emit data: chunks of 'x' with a newline every `line` bytes, written
+    // from a pattern made once, one line longer than a chunk, so that each
+    // chunk is a slice of it starting where the previous one left off
+    if (emit!=0) {
+        std::vector<char> buf(chunk+line,'x');
+        for(auto i=line;line && i<=buf.size();i+=line) buf[i-1] = '\n';
+        const auto start = Clock::now();
+        long long done = 0;
+        while(emit<0 || done<emit) {
+            const auto n = emit<0 ? chunk : size_t(std::min<long long>(chunk,emit-done));
+            if (!write_all(out,buf.data() + (line ? done%line : 0),n)) break;
+            done += n;
+            throttle(start,done,rate);
+        }
+    }
+
+    // Read stdin, and copy it to the output if echoing
+    if (consume || echo) {
+        std::vector<char> buf(chunk);
+        const auto start = Clock::now();
+        long long done = 0;
+        for(;;) {
+            const auto n = read(STDIN_FILENO,buf.data(),buf.size());
+            if (n<0 && errno==EINTR) continue;
+            if (n<=0) break;
+            if (echo && !write_all(out,buf.data(),n)) break;
+            done += n;
+            throttle(start,done,rate);
+        }
+    }
+
+    if (burn_ms>0) burn(burn_ms);
+    if (delay_ms>0) std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+    return status;
+}